@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../runtime/cilk2c.h"
+#include "../runtime/cilk2c_inlined.c"
+#include "cilkify_region.h"
+#include "ktiming.h"
+
+/*
+ * Measures the round trip of entering and leaving a Cilkified region, which
+ * is dominated by the handoffs between the calling thread and the workers.
+ * Each call to region() is one tiny Cilkified region (see cilkify_region.h).
+ *
+ * Try CILK_HANDOFF_SPIN=<usec> and CILK_BOSS_WORKER=1 to compare protocols.
+ */
+
+#define WARMUP 100
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_percentile(const char *name, uint64_t *sorted, int n,
+                             double pct) {
+    int i = (int)(pct / 100.0 * (n - 1));
+    printf("%-6s %10.2f us\n", name, sorted[i] / 1000.0);
+}
+
+int main(int argc, char * args[]) {
+    int i, n = 10000, x = 0;
+    clockmark_t begin, end;
+
+    if(argc > 2) {
+        fprintf(stderr, "Usage: cilkify_latency [<cilk-options>] [<regions>]\n");
+        exit(1);
+    }
+    if(argc == 2)
+        n = atoi(args[1]);
+    if(n < 1)
+        n = 1;
+
+    uint64_t *latency = (uint64_t *)malloc(n * sizeof(uint64_t));
+
+    for(i = 0; i < WARMUP; i++)
+        region(&x);
+
+    for(i = 0; i < n; i++) {
+        begin = ktiming_getmark();
+        region(&x);
+        end = ktiming_getmark();
+        latency[i] = ktiming_diff_nsec(&begin, &end);
+    }
+
+    if(x != WARMUP + n) {
+        fprintf(stderr, "Wrong result: %d\n", x);
+        exit(1);
+    }
+
+    qsort(latency, n, sizeof(uint64_t), cmp_u64);
+    printf("Cilkify round trip over %d regions\n", n);
+    print_percentile("p50", latency, n, 50.0);
+    print_percentile("p90", latency, n, 90.0);
+    print_percentile("p99", latency, n, 99.0);
+    print_percentile("p99.9", latency, n, 99.9);
+    print_percentile("max", latency, n, 100.0);
+    free(latency);
+
+    return 0;
+}
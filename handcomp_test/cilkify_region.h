@@ -0,0 +1,56 @@
+#ifndef _CILKIFY_REGION_H
+#define _CILKIFY_REGION_H
+
+/*
+ * One tiny Cilkified region, shared by cilkify_latency and fiber_startup.
+ * Include it after ../runtime/cilk2c_inlined.c.  Each call to region() is
+ * the hand-compiled version of:
+ *
+void region(int *x) {
+    cilk_spawn work(x);
+    cilk_sync;
+}
+ */
+
+extern size_t ZERO;
+void __attribute__((weak)) dummy(void *p) { return; }
+
+static void __attribute__ ((noinline)) work(int *x) { *x += 1; }
+
+static void __attribute__ ((noinline)) region_spawn_helper(int *x);
+
+static void __attribute__ ((noinline)) region(int *x) {
+    dummy(alloca(ZERO));
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame(&sf);
+
+    /* cilk_spawn work(x) */
+    __cilkrts_save_fp_ctrl_state(&sf);
+    if(!__builtin_setjmp(sf.ctx)) {
+      region_spawn_helper(x);
+    }
+
+    /* cilk_sync */
+    if(sf.flags & CILK_FRAME_UNSYNCHED) {
+      __cilkrts_save_fp_ctrl_state(&sf);
+      if(!__builtin_setjmp(sf.ctx)) {
+        __cilkrts_sync(&sf);
+      }
+    }
+
+    __cilkrts_pop_frame(&sf);
+    if (0 != sf.flags)
+        __cilkrts_leave_frame(&sf);
+}
+
+static void __attribute__ ((noinline)) region_spawn_helper(int *x) {
+
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame_fast(&sf);
+    __cilkrts_detach(&sf);
+    work(x);
+    __cilkrts_pop_frame(&sf);
+    __cilkrts_leave_frame(&sf);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../runtime/cilk2c.h"
+#include "../runtime/cilk2c_inlined.c"
+#include "cilkify_region.h"
+#include "ktiming.h"
+
+/*
+ * Measures the cost of filling the fiber pools.  The first Cilkified region
+ * starts the workers, each of which allocates half of its fiber pool, so its
+ * round trip is dominated by stack allocation.  Also reports how many memory
+ * mappings (VMAs) the process gained, which bounds how large the pools can
+ * grow under vm.max_map_count.  The region is the one of cilkify_latency
+ * (see cilkify_region.h).
+ *
+ * Compare CILK_STACK_ARENA=0 and 1, with CILK_FIBER_POOL=<fibers per
+ * worker> to vary the pool size.
+ */
+
+// The number of mappings of this process, or -1 if it cannot be read.
+static int count_vmas(void) {
+    FILE *f = fopen("/proc/self/maps", "r");
+    if (!f)
+        return -1;
+    int n = 0, c;
+    while ((c = fgetc(f)) != EOF)
+        n += c == '\n';
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char * args[]) {
+    int x = 0;
+    clockmark_t begin, end;
+
+    if(argc != 1) {
+        fprintf(stderr, "Usage: fiber_startup [<cilk-options>]\n");
+        exit(1);
+    }
+
+    int vmas_before = count_vmas();
+    begin = ktiming_getmark();
+    region(&x);
+    end = ktiming_getmark();
+    uint64_t first = ktiming_diff_nsec(&begin, &end);
+    int vmas_after = count_vmas();
+
+    begin = ktiming_getmark();
+    region(&x);
+    end = ktiming_getmark();
+    uint64_t second = ktiming_diff_nsec(&begin, &end);
+
+    if(x != 2) {
+        fprintf(stderr, "Wrong result: %d\n", x);
+        exit(1);
+    }
+
+    printf("First region  %10.2f us\n", first / 1000.0);
+    printf("Second region %10.2f us\n", second / 1000.0);
+    printf("Mappings      %10d added\n", vmas_after - vmas_before);
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../runtime/cilk2c.h"
+#include "../runtime/cilk2c_inlined.c"
+#include "ktiming.h"
+
+
+#ifndef TIMING_COUNT 
+#define TIMING_COUNT 1 
+#endif
+
+/*
+ * Nests spawns n deep, so the shadow stack of the worker running the chain
+ * holds n frames at the bottom.  Run with a small CILK_DEQDEPTH to make it
+ * grow many times.
+ *
+int chain(int n) {
+    int x;
+
+    if(n == 0) {
+        return 0;
+    }
+
+    x = cilk_spawn chain(n - 1);
+    cilk_sync;
+
+    return x+1;
+}
+*/
+
+extern size_t ZERO;
+void __attribute__((weak)) dummy(void *p) { return; }
+
+static void __attribute__ ((noinline)) chain_spawn_helper(int *x, int n); 
+
+int chain(int n) {
+    int x, _tmp;
+
+    if(n == 0)
+        return 0;
+
+    dummy(alloca(ZERO));
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame(&sf);
+
+    /* x = spawn chain(n-1) */
+    __cilkrts_save_fp_ctrl_state(&sf);
+    if(!__builtin_setjmp(sf.ctx)) {
+      chain_spawn_helper(&x, n-1);
+    }
+
+    /* cilk_sync */
+    if(sf.flags & CILK_FRAME_UNSYNCHED) {
+      __cilkrts_save_fp_ctrl_state(&sf);
+      if(!__builtin_setjmp(sf.ctx)) {
+        __cilkrts_sync(&sf);
+      }
+    }
+    _tmp = x + 1;
+
+    __cilkrts_pop_frame(&sf);
+    if (0 != sf.flags)
+        __cilkrts_leave_frame(&sf);
+
+    return _tmp;
+}
+
+static void __attribute__ ((noinline)) chain_spawn_helper(int *x, int n) {
+
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame_fast(&sf);
+    __cilkrts_detach(&sf);
+    *x = chain(n);
+    __cilkrts_pop_frame(&sf);
+    __cilkrts_leave_frame(&sf);
+}
+
+int main(int argc, char * args[]) {
+    int i;
+    int n, res;
+    clockmark_t begin, end; 
+    uint64_t running_time[TIMING_COUNT];
+
+    if(argc != 2) {
+        fprintf(stderr, "Usage: spawn_chain [<cilk-options>] <n>\n");
+        exit(1);
+    }
+    
+    n = atoi(args[1]);
+
+    for(i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res = chain(n);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d\n", res);
+
+    print_runtime(running_time, TIMING_COUNT); 
+
+    return res != n;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../runtime/cilk2c.h"
+#include "../runtime/cilk2c_inlined.c"
+#include "ktiming.h"
+
+
+#ifndef TIMING_COUNT 
+#define TIMING_COUNT 1 
+#endif
+
+/*
+ * A shallow, wide spawn tree: one loop spawns n small binary trees of the
+ * given depth.  Compare runs with CILK_STEAL_BATCH=1 and, say,
+ * CILK_STEAL_BATCH=4, and add CILK_ALERT=0x8000 to print the steal counts
+ * of each worker at exit.
+ *
+long tree(int d) {
+    long x, y;
+
+    if(d == 0) {
+        return leaf();
+    }
+
+    x = cilk_spawn tree(d - 1);
+    y = tree(d - 1);
+    cilk_sync;
+
+    return x+y;
+}
+
+long wide(int n, int d) {
+    long sum[n];
+
+    for(int i = 0; i < n; i++) {
+        sum[i] = cilk_spawn tree(d);
+    }
+    cilk_sync;
+
+    return sum of sum[];
+}
+*/
+
+extern size_t ZERO;
+void __attribute__((weak)) dummy(void *p) { return; }
+
+static long __attribute__ ((noinline)) leaf(void) {
+    volatile long x = 0;
+    for(int i = 0; i < 1000; i++)
+        x += i & 1;
+    return x == 500;
+}
+
+static void __attribute__ ((noinline)) tree_spawn_helper(long *x, int d); 
+
+long tree(int d) {
+    long x, y, _tmp;
+
+    if(d == 0)
+        return leaf();
+
+    dummy(alloca(ZERO));
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame(&sf);
+
+    /* x = spawn tree(d-1) */
+    __cilkrts_save_fp_ctrl_state(&sf);
+    if(!__builtin_setjmp(sf.ctx)) {
+      tree_spawn_helper(&x, d-1);
+    }
+
+    y = tree(d - 1);
+
+    /* cilk_sync */
+    if(sf.flags & CILK_FRAME_UNSYNCHED) {
+      __cilkrts_save_fp_ctrl_state(&sf);
+      if(!__builtin_setjmp(sf.ctx)) {
+        __cilkrts_sync(&sf);
+      }
+    }
+    _tmp = x + y;
+
+    __cilkrts_pop_frame(&sf);
+    if (0 != sf.flags)
+        __cilkrts_leave_frame(&sf);
+
+    return _tmp;
+}
+
+static void __attribute__ ((noinline)) tree_spawn_helper(long *x, int d) {
+
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame_fast(&sf);
+    __cilkrts_detach(&sf);
+    *x = tree(d);
+    __cilkrts_pop_frame(&sf);
+    __cilkrts_leave_frame(&sf);
+}
+
+long wide(int n, int d, long *sum) {
+    long _tmp = 0;
+
+    dummy(alloca(ZERO));
+    __cilkrts_stack_frame sf;
+    __cilkrts_enter_frame(&sf);
+
+    for(int i = 0; i < n; i++) {
+      /* sum[i] = spawn tree(d) */
+      __cilkrts_save_fp_ctrl_state(&sf);
+      if(!__builtin_setjmp(sf.ctx)) {
+        tree_spawn_helper(&sum[i], d);
+      }
+    }
+
+    /* cilk_sync */
+    if(sf.flags & CILK_FRAME_UNSYNCHED) {
+      __cilkrts_save_fp_ctrl_state(&sf);
+      if(!__builtin_setjmp(sf.ctx)) {
+        __cilkrts_sync(&sf);
+      }
+    }
+    for(int i = 0; i < n; i++)
+        _tmp += sum[i];
+
+    __cilkrts_pop_frame(&sf);
+    if (0 != sf.flags)
+        __cilkrts_leave_frame(&sf);
+
+    return _tmp;
+}
+
+int main(int argc, char * args[]) {
+    int i;
+    int n, d;
+    long res = 0;
+    clockmark_t begin, end; 
+    uint64_t running_time[TIMING_COUNT];
+
+    if(argc != 3) {
+        fprintf(stderr, "Usage: wide_spawn [<cilk-options>] <n> <depth>\n");
+        exit(1);
+    }
+    
+    n = atoi(args[1]);
+    d = atoi(args[2]);
+    long *sum = (long *)malloc(n * sizeof(long));
+
+    for(i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        res = wide(n, d, sum);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %ld\n", res);
+    print_runtime(running_time, TIMING_COUNT); 
+    free(sum);
+
+    return res != (long)n << d;
+}
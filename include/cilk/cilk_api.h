@@ -1,5 +1,6 @@
 #include <sched.h>
 #include <pthread.h>
+#include <stdint.h>
 #ifndef _CILK_API_H
 #define _CILK_API_H
 #ifdef __cplusplus
@@ -13,17 +14,94 @@ extern unsigned __cilkrts_get_nworkers(void);
 extern unsigned __cilkrts_get_worker_number(void) __attribute__((deprecated));
 struct __cilkrts_worker *__cilkrts_get_tls_worker(void);
 
+// Call body(lo, hi, data) on consecutive subranges [lo, hi) that cover
+// [begin, end), each of at least grain iterations (0 to choose).  The
+// subranges are divided among the runtime's workers up front, and workers
+// that finish early take over the rest.  Reducer views are combined in
+// iteration order.  Called outside a Cilk function, or on a runtime with one
+// worker, it runs body(begin, end, data).  body must not spawn or sync.
+extern void __cilkrts_static_for(void (*body)(long lo, long hi, void *data),
+                                 void *data, long begin, long end, long grain);
+
+// Set by the runtime for each worker thread; use __cilkrts_is_anyone_hungry.
+extern __thread const int *__cilkrts_hungry_groups;
+
+// Whether any worker of the calling worker's runtime is idle and looking for
+// work to steal.  A loop can run its iterations serially while this is false
+// and split off half of the remaining range only when it becomes true (lazy
+// binary splitting), instead of spawning down to a fixed grain size.  It is
+// a hint: a read of a thread-local pointer and one relaxed load through it.
+// In code compiled with -fPIC the thread-local read usually goes through
+// __tls_get_addr, so hoist the check out of the innermost loop rather than
+// calling it every iteration.  Returns 0 on threads that are not workers.
+static inline int __cilkrts_is_anyone_hungry(void) {
+    const int *hungry = __cilkrts_hungry_groups;
+    return hungry && __atomic_load_n(hungry, __ATOMIC_RELAXED) > 0;
+}
+
 
 /** CILK THREADS API **/
 typedef struct {
-	int n_workers;
-    cpu_set_t boss_affinity;
+    int n_workers;           // 0 for one worker per CPU in boss_affinity
+    cpu_set_t boss_affinity; // CPUs of the boss thread and of the workers
+    // Set by cilk_config_init.  The fields after it are used only if it is
+    // CILK_CONFIG_VERSION, so a config that was not initialized that way
+    // can leave them unset.
+    unsigned int version;
+    // Fibers each worker makes for its pool at startup, and fibers made
+    // for the global pool, on the workers' own threads; 0 for
+    // CILK_FIBER_PREWARM and CILK_FIBER_PREWARM_GLOBAL.
+    unsigned int fiber_prewarm;
+    unsigned int fiber_prewarm_global;
+    // Bytes at the top of each of those stacks to fault in; 0 for
+    // CILK_STACK_PREFAULT.
+    size_t stack_prefault;
 } cilk_config_t;
 
+#define CILK_CONFIG_VERSION 0x434b0001u
+
+// Set every field of config to its default, which takes the setting from
+// the environment, and set its version.
+void cilk_config_init(cilk_config_t *config);
+
 #include <pthread.h>
 pthread_t cilk_thrd_current();
 void cilk_thrd_init(cilk_config_t config);
 cilk_config_t cilk_thrd_config_from_env(const char* name);
+
+// A runtime that other threads can run Cilkified regions on.
+typedef struct global_state *cilk_runtime_t;
+// Like cilk_thrd_init, but up to max_roots threads may run Cilkified regions
+// on the new runtime at once, sharing its workers.
+void cilk_thrd_init_shared(cilk_config_t config, int max_roots);
+// The runtime of the calling thread.
+cilk_runtime_t cilk_thrd_runtime(void);
+// Run the calling thread's Cilkified regions on runtime, which must have been
+// created by cilk_thrd_init_shared and must outlive the calling thread's use
+// of it.
+void cilk_thrd_attach(cilk_runtime_t runtime);
+
+// Counts of scheduler events, summed over the workers of a runtime.
+typedef struct {
+    uint64_t steal_attempts;       // attempts to steal from another worker
+    uint64_t steals;               // successful steals
+    uint64_t steal_fail_empty;     // failures: the victim had nothing to steal
+    uint64_t steal_fail_locked;    // failures: another thief held a lock
+    uint64_t steal_fail_returning; // failures: the victim's frame was returning
+    uint64_t steal_fail_dekker;    // failures: the victim popped the frame
+    uint64_t provably_good_steals; // suspended frames resumed by a last child
+    uint64_t failed_syncs;         // syncs that waited for stolen children
+    uint64_t fibers_allocated;     // fibers taken from workers' pools
+    uint64_t global_pool_batches;  // fiber batches through the global pool
+    uint64_t global_pool_retries;  // retried updates of the global pool
+    uint64_t reducer_merges;       // merges of two sets of reducer views
+} cilk_runtime_stats_t;
+// Store in *stats the events of runtime since the previous call, or since
+// it was created, and start counting anew.  The counters are always
+// maintained and the call may be made at any time, e.g., periodically by a
+// thread exporting metrics.  Events in progress may be reported by the next
+// call.
+void cilk_thrd_take_stats(cilk_runtime_t runtime, cilk_runtime_stats_t *stats);
 /** END CILK THREADS API **/
 
 
@@ -15,8 +15,13 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* wrapper struct to hold function and args to pass to
  * newly created pthread
  */
@@ -63,4 +68,46 @@ void cilk_thrd_exit(int res);
 __attribute__((unused))
 int cilk_thrd_join (pthread_t thr, int *res);
 
+/* Handle to the result of a function queued by `cilk_thrd_async()`.
+ */
+typedef struct cilk_future *cilk_future_t;
+
+/* Queues `func(arg)` to run on `runtime`, which must have been created by
+ * `cilk_thrd_init_shared()`, and returns without waiting for it.  Up to the
+ * runtime's max_roots queued functions run at once, on threads the runtime
+ * creates for them.  If `future` is not NULL it receives a handle that must
+ * be passed to exactly one of `cilk_future_wait()`,
+ * `cilk_future_timedwait()` (until it succeeds) or `cilk_future_detach()`.
+ * Returns cilk_thrd_success, cilk_thrd_nomem, or cilk_thrd_error if the
+ * runtime is shutting down.
+ */
+__attribute__((unused))
+int cilk_thrd_async(cilk_runtime_t runtime, cilk_future_t *future, int (*func)(void*), void *arg);
+
+/* Returns whether the function of `future` has returned, without blocking.
+ */
+__attribute__((unused))
+bool cilk_future_ready(cilk_future_t future);
+
+/* Waits for the function of `future` to return, stores its result in `res`
+ * if `res` is not NULL, and frees `future`.
+ */
+__attribute__((unused))
+int cilk_future_wait(cilk_future_t future, int *res);
+
+/* Same as `cilk_future_wait()` but gives up at the absolute CLOCK_REALTIME
+ * time `abstime`, returning cilk_thrd_timedout and keeping `future` valid.
+ */
+__attribute__((unused))
+int cilk_future_timedwait(cilk_future_t future, const struct timespec *abstime, int *res);
+
+/* Releases `future` without waiting; its result is discarded.
+ */
+__attribute__((unused))
+void cilk_future_detach(cilk_future_t future);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif // CILK_C11_H
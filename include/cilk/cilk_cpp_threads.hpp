@@ -3,7 +3,12 @@
 
 #include <cilk/cilk.h>
 #include <cilk/cilk_api.h>
+#include <cilk/cilk_c11_threads.h>
+#include <functional>
+#include <future>
+#include <system_error>
 #include <thread>
+#include <type_traits>
 
 /* General wrapper function to create cilk runtime object and set it's
  * destructor before calling the thrd_args function member.
@@ -23,4 +28,37 @@ std::thread cilk_thread_create(cilk_config_t config, F&& f, Args&&... args) {
 	return thr;
 }
 
+/* Runs a packaged task queued by cilk_async() and frees it.
+ */
+template <class Task>
+int cilk_async_helper(void *task) {
+	Task *t = static_cast<Task *>(task);
+	(*t)();
+	delete t;
+	return 0;
+}
+
+/* Queues `f(args...)` to run on `runtime`, which must have been created by
+ * cilk_thrd_init_shared(), and returns a std::future for its result.  The
+ * arguments are copied as by std::thread.  Throws std::system_error if the
+ * function could not be queued.
+ */
+template <class F, class... Args>
+auto cilk_async(cilk_runtime_t runtime, F&& f, Args&&... args)
+    -> std::future<decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...)())> {
+	auto bound = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+	using R = decltype(bound());
+	using Task = std::packaged_task<R()>;
+	Task *task = new Task(std::move(bound));
+	std::future<R> result = task->get_future();
+	int err = cilk_thrd_async(runtime, nullptr, cilk_async_helper<Task>, task);
+	if (err != cilk_thrd_success) {
+		delete task;
+		throw std::system_error(std::make_error_code(
+		    err == cilk_thrd_nomem ? std::errc::not_enough_memory
+		                           : std::errc::resource_unavailable_try_again));
+	}
+	return result;
+}
+
 #endif
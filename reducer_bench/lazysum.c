@@ -0,0 +1,101 @@
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+/*
+ * Sums the iteration indices of a loop into a reducer twice: by a binary
+ * spawn tree with one leaf per grain iterations, and by lazy binary
+ * splitting, which checks __cilkrts_is_anyone_hungry every grain iterations
+ * and spawns half of the remaining range only when a thief is idle.  Run
+ * with small and large grains: the spawn tree pays for small grains with
+ * spawn overhead and for large ones with load imbalance, while lazy
+ * splitting should run about as fast at any grain.
+ */
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+CILK_C_DECLARE_REDUCER(long)
+my_int_sum_reducer = CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
+                                         0, 0);
+
+void compute_sum(long lo, long hi) {
+    for (long i = lo; i < hi; i++) {
+        REDUCER_VIEW(my_int_sum_reducer) += i;
+    }
+}
+
+void eager_sum(long lo, long hi, long grain) {
+    if (hi - lo <= grain) {
+        compute_sum(lo, hi);
+        return;
+    }
+    long mid = lo + (hi - lo) / 2;
+    cilk_spawn eager_sum(lo, mid, grain);
+    eager_sum(mid, hi, grain);
+    cilk_sync;
+}
+
+void lazy_sum(long lo, long hi, long grain) {
+    while (hi - lo > grain) {
+        compute_sum(lo, lo + grain);
+        lo += grain;
+        if (hi - lo > grain && __cilkrts_is_anyone_hungry()) {
+            long mid = lo + (hi - lo) / 2;
+            cilk_spawn lazy_sum(mid, hi, grain);
+            hi = mid;
+        }
+    }
+    compute_sum(lo, hi);
+    cilk_sync;
+}
+
+static int run(const char *name, void (*sum)(long, long, long), long n,
+               long grain) {
+    int res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    for (int i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        CILK_C_REGISTER_REDUCER(my_int_sum_reducer);
+        *(&REDUCER_VIEW(my_int_sum_reducer)) = 0;
+        sum(0, n, grain);
+        long total = REDUCER_VIEW(my_int_sum_reducer);
+        res += (total == n * (n - 1) / 2) ? 1 : 0;
+        CILK_C_UNREGISTER_REDUCER(my_int_sum_reducer);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("%s, grain %ld: %d/%d successes!\n", name, grain, res,
+           TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+    return res;
+}
+
+int main(int argc, const char **args) {
+    long n, grain = 16;
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: lazysum [<cilk-options>] <n> [<grain>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    if (argc == 3)
+        grain = atol(args[2]);
+    if (grain < 1)
+        grain = 1;
+
+    int res = run("Spawn tree", eager_sum, n, grain);
+    res += run("Lazy splitting", lazy_sum, n, grain);
+
+    return res != 2 * TIMING_COUNT;
+}
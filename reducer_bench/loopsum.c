@@ -0,0 +1,65 @@
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+#include <cilk/reducer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+/*
+ * Sums the iteration indices of a loop run by __cilkrts_static_for into a
+ * reducer.  Compare with intsum, which spawns the same amount of work.
+ */
+
+void identity_longsum(void *reducer, void *sum) { *((long *)sum) = 0; }
+
+void reduce_longsum(void *reducer, void *left, void *right) {
+    *((long *)left) += *((long *)right);
+}
+
+CILK_C_DECLARE_REDUCER(long)
+my_int_sum_reducer = CILK_C_INIT_REDUCER(long, reduce_longsum, identity_longsum,
+                                         0, 0);
+
+void compute_sum(long lo, long hi, void *data) {
+    for (long i = lo; i < hi; i++) {
+        REDUCER_VIEW(my_int_sum_reducer) += i;
+    }
+}
+
+void test_reducer(long limit) {
+    // The spawn makes this a Cilk function, so the loop runs in parallel.
+    cilk_spawn compute_sum(0, 0, NULL);
+    __cilkrts_static_for(compute_sum, NULL, 0, limit, 0);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    long i, n;
+    int res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: loopsum [<cilk-options>] <n>\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        CILK_C_REGISTER_REDUCER(my_int_sum_reducer);
+        *(&REDUCER_VIEW(my_int_sum_reducer)) = 0;
+        test_reducer(n);
+        long sum = REDUCER_VIEW(my_int_sum_reducer);
+        res += (sum == n * (n - 1) / 2) ? 1 : 0;
+        CILK_C_UNREGISTER_REDUCER(my_int_sum_reducer);
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return res != TIMING_COUNT;
+}
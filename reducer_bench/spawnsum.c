@@ -0,0 +1,63 @@
+#include <cilk/cilk.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ktiming.h"
+
+/*
+ * The sum of serialsum, computed by a binary spawn tree with one leaf per
+ * grain iterations.  Run with CILK_NWORKERS=1 and compare against serialsum
+ * for the cost of spawning on one worker, and against CILK_SERIAL=0 for what
+ * the serial fast path saves.
+ */
+
+volatile int my_int_sum = 0;
+
+void compute_sum(long limit) {
+    for (long i = 0; i < limit; i++) {
+        my_int_sum += 1;
+    }
+}
+
+void sum_range(long n, long grain) {
+    if (n <= grain) {
+        compute_sum(n);
+        return;
+    }
+    cilk_spawn sum_range(n / 2, grain);
+    sum_range(n - n / 2, grain);
+    cilk_sync;
+}
+
+int main(int argc, const char **args) {
+    int i;
+    long n, grain = 16;
+    int res = 0;
+    clockmark_t begin, end;
+    uint64_t running_time[TIMING_COUNT];
+
+    if (argc != 2 && argc != 3) {
+        fprintf(stderr, "Usage: spawnsum [<cilk-options>] <n> [<grain>]\n");
+        exit(1);
+    }
+
+    n = atol(args[1]);
+    if (argc == 3)
+        grain = atol(args[2]);
+    if (grain < 1)
+        grain = 1;
+
+    for (i = 0; i < TIMING_COUNT; i++) {
+        begin = ktiming_getmark();
+        my_int_sum = 0;
+        sum_range(2 * n, grain);
+        int sum = my_int_sum;
+        res += (sum == 2 * n) ? 1 : 0;
+        end = ktiming_getmark();
+        running_time[i] = ktiming_diff_nsec(&begin, &end);
+    }
+    printf("Result: %d/%d successes!\n", res, TIMING_COUNT);
+    print_runtime(running_time, TIMING_COUNT);
+
+    return 0;
+}
@@ -0,0 +1,241 @@
+// Process-wide core arbiter.
+//
+// When several runtimes share CPUs (e.g., multicilk runtimes created with
+// overlapping cpusets), each one running all of its workers oversubscribes
+// the machine.  The arbiter owns a budget of CILK_ARBITER_CORES workers for
+// the whole process and periodically divides it among the registered
+// runtimes by setting each runtime's active_workers.  Workers above that
+// limit park in the steal loop (see worker_park_lent) and are unparked when
+// their runtime is given more workers, so no threads are created or
+// destroyed to move capacity between runtimes.
+//
+// Every CILK_ARBITER_INTERVAL microseconds the arbiter looks at how each
+// runtime's workers spent the last interval, using the scheduler counters:
+//
+//   - A runtime that started no Cilkified region during the interval, is
+//     not in one now, and whose workers neither stole nor parked needs only
+//     one worker.  Looking at the whole interval rather than at whether the
+//     runtime is in a region at the moment keeps the share of a runtime
+//     running many short regions.
+//   - A runtime whose active workers spent more than half the interval
+//     parked, or whose steal attempts almost all failed, gives up a worker.
+//   - A runtime in a Cilkified region whose workers were almost never idle
+//     is hungry, and hungry runtimes share any unused budget round-robin.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "arbiter.h"
+#include "cilk-internal.h"
+#include "debug.h"
+#include "global.h"
+#include "local.h"
+#include "park.h"
+
+#define DEFAULT_ARBITER_INTERVAL 10000 // microseconds
+
+struct arbiter_entry {
+    global_state *g;
+    // Counter totals over g's workers, and g->regions, at the previous
+    // decision
+    uint64_t parked_ns, steal_attempts, steals, regions;
+};
+
+static struct {
+    pthread_mutex_t lock;
+    pthread_t thread;
+    bool running;
+    unsigned int budget;   // workers to divide among runtimes, 0 if disabled
+    unsigned int interval; // microseconds between decisions
+    unsigned int next;     // where to start handing out spare workers
+    unsigned int size, capacity;
+    struct arbiter_entry *entries;
+} arbiter = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static pthread_once_t arbiter_once = PTHREAD_ONCE_INIT;
+
+static void arbiter_read_environment(void) {
+    long budget = env_get_int("CILK_ARBITER_CORES");
+    long interval = env_get_int("CILK_ARBITER_INTERVAL");
+    arbiter.budget = budget > 0 ? budget : 0;
+    arbiter.interval = interval > 0 ? interval : DEFAULT_ARBITER_INTERVAL;
+}
+
+static uint64_t counter_total(global_state *g, enum counter_type t) {
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < g->nworkers; ++i) {
+        total += atomic_load_explicit(&g->workers[i]->l->counters.count[t],
+                                      memory_order_relaxed);
+    }
+    return total;
+}
+
+static unsigned int active_workers(global_state *g) {
+    return atomic_load_explicit(&g->active_workers, memory_order_relaxed);
+}
+
+// Decide how many workers each runtime should use.  Called with the lock
+// held.
+static void arbiter_rebalance(void) {
+    unsigned int n = arbiter.size;
+    unsigned int total = 0;
+    bool hungry[n];
+
+    for (unsigned int i = 0; i < n; ++i) {
+        struct arbiter_entry *e = &arbiter.entries[i];
+        global_state *g = e->g;
+        unsigned int active = active_workers(g);
+
+        uint64_t parked_ns = counter_total(g, COUNTER_PARK_NS);
+        uint64_t attempts = counter_total(g, COUNTER_STEAL_ATTEMPT);
+        uint64_t steals = counter_total(g, COUNTER_STEAL);
+        uint64_t regions =
+            atomic_load_explicit(&g->regions, memory_order_relaxed);
+        uint64_t idle = parked_ns - e->parked_ns;
+        uint64_t tried = attempts - e->steal_attempts;
+        uint64_t failed = tried - (steals - e->steals);
+        bool started = regions != e->regions;
+        e->parked_ns = parked_ns;
+        e->steal_attempts = attempts;
+        e->steals = steals;
+        e->regions = regions;
+
+        uint64_t capacity = (uint64_t)active * arbiter.interval * 1000;
+        bool cilkified =
+            atomic_load_explicit(&g->cilkified, memory_order_relaxed);
+
+        hungry[i] = false;
+        if (!cilkified && !started && tried == 0 && idle == 0) {
+            active = 1;
+        } else if (idle * 2 > capacity ||
+                   (tried > 100 && failed * 20 > tried * 19)) {
+            if (active > 1)
+                --active;
+        } else if (idle * 10 < capacity) {
+            hungry[i] = true;
+        }
+        if (active != active_workers(g))
+            set_active_workers(g, active);
+        total += active;
+    }
+
+    // Hand out unused budget one worker at a time.
+    bool gave = true;
+    while (total < arbiter.budget && gave) {
+        gave = false;
+        for (unsigned int k = 0; k < n && total < arbiter.budget; ++k) {
+            unsigned int i = (arbiter.next + k) % n;
+            global_state *g = arbiter.entries[i].g;
+            unsigned int active = active_workers(g);
+            if (hungry[i] && active < g->nworkers) {
+                set_active_workers(g, active + 1);
+                ++total;
+                gave = true;
+            }
+        }
+        arbiter.next = n ? (arbiter.next + 1) % n : 0;
+    }
+
+    // Take back workers over budget from the runtimes with the most.
+    while (total > arbiter.budget) {
+        global_state *largest = NULL;
+        for (unsigned int i = 0; i < n; ++i) {
+            global_state *g = arbiter.entries[i].g;
+            if (active_workers(g) > 1 &&
+                (!largest || active_workers(g) > active_workers(largest)))
+                largest = g;
+        }
+        if (!largest)
+            break;
+        set_active_workers(largest, active_workers(largest) - 1);
+        --total;
+    }
+}
+
+static void *arbiter_thread_proc(void *arg) {
+    struct timespec interval = {.tv_sec = arbiter.interval / 1000000,
+                                .tv_nsec = (arbiter.interval % 1000000) *
+                                           1000};
+    pthread_mutex_lock(&arbiter.lock);
+    while (arbiter.running) {
+        pthread_mutex_unlock(&arbiter.lock);
+        nanosleep(&interval, NULL);
+        pthread_mutex_lock(&arbiter.lock);
+        if (arbiter.running)
+            arbiter_rebalance();
+    }
+    pthread_mutex_unlock(&arbiter.lock);
+    return NULL;
+}
+
+void arbiter_register(global_state *g) {
+    pthread_once(&arbiter_once, arbiter_read_environment);
+    if (arbiter.budget == 0)
+        return;
+
+    pthread_mutex_lock(&arbiter.lock);
+    if (arbiter.size == arbiter.capacity) {
+        unsigned int capacity = arbiter.capacity ? 2 * arbiter.capacity : 4;
+        struct arbiter_entry *larger = (struct arbiter_entry *)realloc(
+            arbiter.entries, capacity * sizeof(struct arbiter_entry));
+        if (!larger) {
+            CILK_ABORT(NULL, "out of arbiter memory");
+            // Leave g unmanaged; it keeps all of its workers.
+            pthread_mutex_unlock(&arbiter.lock);
+            return;
+        }
+        arbiter.entries = larger;
+        arbiter.capacity = capacity;
+    }
+    arbiter.entries[arbiter.size++] = (struct arbiter_entry){
+        .g = g,
+        .parked_ns = counter_total(g, COUNTER_PARK_NS),
+        .steal_attempts = counter_total(g, COUNTER_STEAL_ATTEMPT),
+        .steals = counter_total(g, COUNTER_STEAL),
+        .regions = atomic_load_explicit(&g->regions, memory_order_relaxed),
+    };
+    cilkrts_alert(BOOT, NULL, "(arbiter_register) %u runtimes, budget %u",
+                  arbiter.size, arbiter.budget);
+
+    if (!arbiter.running) {
+        arbiter.running = true;
+        int status = pthread_create(&arbiter.thread, NULL,
+                                    arbiter_thread_proc, NULL);
+        if (status != 0)
+            cilkrts_bug(NULL, "Cilk: arbiter thread creation failed: %d",
+                        status);
+    }
+    pthread_mutex_unlock(&arbiter.lock);
+}
+
+void arbiter_unregister(global_state *g) {
+    if (arbiter.budget == 0)
+        return;
+
+    // A later arbiter_register may start a new thread as soon as the lock
+    // is dropped, so remember which thread to join.
+    bool stop = false;
+    pthread_t thread;
+    pthread_mutex_lock(&arbiter.lock);
+    for (unsigned int i = 0; i < arbiter.size; ++i) {
+        if (arbiter.entries[i].g == g) {
+            arbiter.entries[i] = arbiter.entries[--arbiter.size];
+            break;
+        }
+    }
+    if (arbiter.size == 0 && arbiter.running) {
+        arbiter.running = false;
+        thread = arbiter.thread;
+        stop = true;
+    }
+    pthread_mutex_unlock(&arbiter.lock);
+
+    // Let all of g's workers run again, e.g., to leave the runtime.
+    set_active_workers(g, g->nworkers);
+
+    if (stop)
+        pthread_join(thread, NULL);
+}
@@ -0,0 +1,12 @@
+#ifndef _CILK_ARBITER_H
+#define _CILK_ARBITER_H
+
+#include "cilk-internal.h"
+
+// Add g to, or remove g from, the runtimes among which the process-wide core
+// arbiter divides its budget of workers.  These do nothing unless the
+// arbiter is enabled with CILK_ARBITER_CORES.
+CHEETAH_INTERNAL void arbiter_register(global_state *g);
+CHEETAH_INTERNAL void arbiter_unregister(global_state *g);
+
+#endif /* _CILK_ARBITER_H */
@@ -0,0 +1,234 @@
+// Asynchronous Cilkified regions.
+//
+// cilk_thrd_async queues a function on a shared runtime and returns at once.
+// The runtime keeps up to options.max_roots submitter threads, attached to it
+// like threads that called cilk_thrd_attach.  A submitter takes the next
+// queued function and calls it, Cilkifying it if it is a Cilk function, then
+// completes its future.  Submitters are created when more functions are
+// queued than there are idle submitters, so as many queued functions run at
+// once as the runtime has roots.  They are stopped at shutdown, after the
+// queue drains.
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <cilk/cilk_c11_threads.h>
+
+#include "async.h"
+#include "debug.h"
+#include "global.h"
+
+struct cilk_future {
+    int (*func)(void *);
+    void *arg;
+    int result;
+    atomic_bool done;
+    bool detached;        // no one will wait; free on completion
+    pthread_mutex_t lock; // with cond_var, for waiting on done
+    pthread_cond_t cond_var;
+    struct cilk_future *next;
+};
+
+struct cilk_async {
+    pthread_mutex_t lock;
+    pthread_cond_t cond_var; // signaled when a function is queued
+    struct cilk_future *head, *tail;
+    unsigned int nqueued;
+    unsigned int nidle;
+    unsigned int nthreads;
+    bool stopping;
+    pthread_t *threads; // options.max_roots of them
+};
+
+static void future_free(struct cilk_future *f) {
+    pthread_mutex_destroy(&f->lock);
+    pthread_cond_destroy(&f->cond_var);
+    free(f);
+}
+
+static void future_complete(struct cilk_future *f, int result) {
+    pthread_mutex_lock(&f->lock);
+    if (f->detached) {
+        pthread_mutex_unlock(&f->lock);
+        future_free(f);
+        return;
+    }
+    f->result = result;
+    atomic_store_explicit(&f->done, true, memory_order_release);
+    pthread_cond_broadcast(&f->cond_var);
+    pthread_mutex_unlock(&f->lock);
+}
+
+static void *submitter_proc(void *arg) {
+    global_state *g = (global_state *)arg;
+    struct cilk_async *a = g->async;
+    my_cilkrts = g;
+
+    pthread_mutex_lock(&a->lock);
+    while (true) {
+        while (!a->head && !a->stopping) {
+            ++a->nidle;
+            pthread_cond_wait(&a->cond_var, &a->lock);
+            --a->nidle;
+        }
+        struct cilk_future *f = a->head;
+        if (!f)
+            break;
+        a->head = f->next;
+        if (!a->head)
+            a->tail = NULL;
+        --a->nqueued;
+        pthread_mutex_unlock(&a->lock);
+
+        future_complete(f, f->func(f->arg));
+
+        pthread_mutex_lock(&a->lock);
+    }
+    pthread_mutex_unlock(&a->lock);
+    my_cilkrts = NULL;
+    return NULL;
+}
+
+// Get the submission queue of g, creating it on first use.
+static struct cilk_async *async_get(global_state *g) {
+    pthread_mutex_lock(&g->roots_lock);
+    struct cilk_async *a = g->async;
+    if (!a) {
+        a = (struct cilk_async *)calloc(1, sizeof(struct cilk_async));
+        a->threads =
+            (pthread_t *)calloc(g->options.max_roots, sizeof(pthread_t));
+        pthread_mutex_init(&a->lock, NULL);
+        pthread_cond_init(&a->cond_var, NULL);
+        g->async = a;
+    }
+    pthread_mutex_unlock(&g->roots_lock);
+    return a;
+}
+
+void async_deinit(global_state *g) {
+    struct cilk_async *a = g->async;
+    if (!a)
+        return;
+    pthread_mutex_lock(&a->lock);
+    a->stopping = true;
+    pthread_cond_broadcast(&a->cond_var);
+    pthread_mutex_unlock(&a->lock);
+
+    for (unsigned int i = 0; i < a->nthreads; ++i)
+        pthread_join(a->threads[i], NULL);
+    CILK_ASSERT_G(a->head == NULL);
+
+    pthread_mutex_destroy(&a->lock);
+    pthread_cond_destroy(&a->cond_var);
+    free(a->threads);
+    free(a);
+    g->async = NULL;
+}
+
+int cilk_thrd_async(cilk_runtime_t runtime, cilk_future_t *future,
+                    int (*func)(void *), void *arg) {
+    global_state *g = runtime;
+    if (g == NULL || g->options.max_roots == 0)
+        cilkrts_bug(NULL, "cilk_thrd_async: the runtime was not created by "
+                          "cilk_thrd_init_shared");
+
+    struct cilk_future *f =
+        (struct cilk_future *)malloc(sizeof(struct cilk_future));
+    if (!f)
+        return cilk_thrd_nomem;
+    f->func = func;
+    f->arg = arg;
+    f->result = 0;
+    atomic_init(&f->done, false);
+    f->detached = (future == NULL);
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->cond_var, NULL);
+    f->next = NULL;
+
+    struct cilk_async *a = async_get(g);
+    int err = 0;
+    pthread_mutex_lock(&a->lock);
+    if (a->stopping) {
+        err = cilk_thrd_error;
+    } else {
+        if (a->tail)
+            a->tail->next = f;
+        else
+            a->head = f;
+        a->tail = f;
+        ++a->nqueued;
+        if (a->nqueued > a->nidle && a->nthreads < g->options.max_roots) {
+            if (pthread_create(&a->threads[a->nthreads], NULL, submitter_proc,
+                               g) == 0)
+                ++a->nthreads;
+            else if (a->nthreads == 0)
+                err = cilk_thrd_error;
+        }
+        if (err) {
+            // No submitter to run f; take it back off the queue.
+            a->head = a->tail = NULL;
+            --a->nqueued;
+        } else {
+            pthread_cond_signal(&a->cond_var);
+        }
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    if (err) {
+        future_free(f);
+        return err;
+    }
+    cilkrts_alert(BOOT, NULL, "(cilk_thrd_async) queued %p", (void *)f);
+    if (future)
+        *future = f;
+    return cilk_thrd_success;
+}
+
+bool cilk_future_ready(cilk_future_t future) {
+    return atomic_load_explicit(&future->done, memory_order_acquire);
+}
+
+// The waiting functions take future->lock even if the future is ready, so
+// that the submitter is done with it before it is freed.
+
+int cilk_future_wait(cilk_future_t future, int *res) {
+    pthread_mutex_lock(&future->lock);
+    while (!atomic_load_explicit(&future->done, memory_order_relaxed))
+        pthread_cond_wait(&future->cond_var, &future->lock);
+    pthread_mutex_unlock(&future->lock);
+    if (res)
+        *res = future->result;
+    future_free(future);
+    return cilk_thrd_success;
+}
+
+int cilk_future_timedwait(cilk_future_t future,
+                          const struct timespec *abstime, int *res) {
+    int err = 0;
+    pthread_mutex_lock(&future->lock);
+    while (!atomic_load_explicit(&future->done, memory_order_relaxed) &&
+           err != ETIMEDOUT)
+        err = pthread_cond_timedwait(&future->cond_var, &future->lock,
+                                     abstime);
+    bool done = atomic_load_explicit(&future->done, memory_order_relaxed);
+    pthread_mutex_unlock(&future->lock);
+    if (!done)
+        return cilk_thrd_timedout;
+    if (res)
+        *res = future->result;
+    future_free(future);
+    return cilk_thrd_success;
+}
+
+void cilk_future_detach(cilk_future_t future) {
+    pthread_mutex_lock(&future->lock);
+    bool done = atomic_load_explicit(&future->done, memory_order_relaxed);
+    future->detached = true;
+    pthread_mutex_unlock(&future->lock);
+    if (done)
+        future_free(future);
+}
@@ -0,0 +1,10 @@
+#ifndef _CILK_ASYNC_H
+#define _CILK_ASYNC_H
+
+#include "global.h"
+
+// Wait for the regions submitted by cilk_thrd_async to finish and stop the
+// threads that run them.  Executed at shutdown, before the workers stop.
+CHEETAH_INTERNAL void async_deinit(global_state *g);
+
+#endif /* _CILK_ASYNC_H */
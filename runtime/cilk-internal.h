@@ -194,16 +194,23 @@ enum __cilkrts_worker_state {
 };
 
 /**
- * NOTE: if you are using the Tapir compiler, you should not change
- * these fields; ok to change for hand-compiled code.
- * See Tapir compiler ABI:
+ * NOTE: the OpenCilk compiler takes the layout of this struct from the ABI
+ * bitcode built from cilk2c_inlined.c, so fields may be moved as long as
+ * that bitcode is rebuilt.  The older Tapir compiler hard-codes the field
+ * order; see its ABI:
  * https://github.com/OpenCilk/opencilk-project/blob/release/9.x/llvm/lib/Transforms/Tapir/CilkRABI.cpp
+ *
+ * The fields are split by who writes them.  The owner writes the first
+ * cache line on every spawn and call; thieves write head and exc, which
+ * are on a line of their own so that a steal attempt does not take away
+ * the line the owner is working on.
  **/
 struct __cilkrts_worker {
-    // T and H pointers in the THE protocol
+    // T pointer in the THE protocol
     _Atomic(__cilkrts_stack_frame **) tail;
-    _Atomic(__cilkrts_stack_frame **) head;
-    _Atomic(__cilkrts_stack_frame **) exc;
+
+    // A slot that points to the currently executing Cilk frame.
+    __cilkrts_stack_frame *current_stack_frame;
 
     // Limit of the Lazy Task Queue, to detect queue overflow
     __cilkrts_stack_frame **ltq_limit;
@@ -211,17 +218,23 @@ struct __cilkrts_worker {
     // Worker id, a small integer
     worker_id self;
 
+    // Set when this is the only worker of its runtime and nothing can be
+    // stolen from it, so spawns need not be pushed on the deque.
+    bool serial;
+
     // Global state of the runtime system, opaque to the client.
     global_state *g;
 
     // Additional per-worker state hidden from the client.
     local_state *l;
 
-    // A slot that points to the currently executing Cilk frame.
-    __cilkrts_stack_frame *current_stack_frame;
-
     // Map from reducer names to reducer values
     cilkred_map *reducer_map;
+
+    // H and E pointers in the THE protocol
+    _Atomic(__cilkrts_stack_frame **) head
+        __attribute__((aligned(CILK_CACHE_LINE)));
+    _Atomic(__cilkrts_stack_frame **) exc;
 };
 
 struct cilkrts_callbacks {
@@ -54,12 +54,12 @@ void cilk_thrd_shutdown(void* n) {
     __cilkrts_shutdown(my_cilkrts);
 }
 
-void cilk_thrd_init(cilk_config_t config) {
+static void thrd_init(cilk_config_t config, unsigned int max_roots) {
     if (__cilkrts_is_initialized()) {
         printf("Error CILKRTS is already initalized!\n");
     }
     //printf("Initializing cilkrts for new thread %llu\n", pthread_self());
-    my_cilkrts = __cilkrts_startup(config.n_workers, NULL);
+    my_cilkrts = __cilkrts_startup(&config, max_roots);
 
     for (unsigned i = 0; i < cilkrts_callbacks.last_init; ++i)
         cilkrts_callbacks.init[i]();
@@ -71,6 +71,47 @@ void cilk_thrd_init(cilk_config_t config) {
     pthread_setspecific(key, my_cilkrts); // so that its not null and will have destructor called.
 }
 
+void cilk_config_init(cilk_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->version = CILK_CONFIG_VERSION;
+}
+
+void cilk_thrd_init(cilk_config_t config) { thrd_init(config, 0); }
+
+void cilk_thrd_init_shared(cilk_config_t config, int max_roots) {
+    if (max_roots < 1) {
+        printf("WARNING: cilk_thrd_init_shared called with max_roots %d. "
+               "Using 1.\n", max_roots);
+        max_roots = 1;
+    }
+    thrd_init(config, max_roots);
+}
+
+cilk_runtime_t cilk_thrd_runtime(void) { return my_cilkrts; }
+
+void cilk_thrd_attach(cilk_runtime_t runtime) {
+    if (runtime == NULL || runtime->options.max_roots == 0)
+        cilkrts_bug(NULL, "cilk_thrd_attach: the runtime was not created by "
+                          "cilk_thrd_init_shared");
+    my_cilkrts = runtime;
+}
+
+// The digits of the value data of key name in a cilk thread config string,
+// as a number.  Other characters are ignored with a warning.
+static unsigned long config_number(const char *cilk_env_name, const char *name,
+                                   const char *data) {
+    unsigned long n = 0;
+    for (const char *p = data; *p; p++) {
+        if (*p >= '0' && *p <= '9') {
+            n = n * 10 + (*p - '0');
+            continue;
+        }
+        printf("WARNING: Cilk environment variable %s specified the key %s with a value that contained an invalid character '%c' This character will be ignored.\n",
+               cilk_env_name, name, *p);
+    }
+    return n;
+}
+
 cilk_config_t cilk_thrd_config_from_env(const char* cilk_env_name) {
     char* value = NULL;
     if (cilk_env_name != NULL)
@@ -78,7 +119,7 @@ cilk_config_t cilk_thrd_config_from_env(const char* cilk_env_name) {
     if (value == NULL) {
         printf("WARNING cilk config environment variable %s is not defined. Using default cilk config \n", cilk_env_name);
         cilk_config_t cfg;
-        cfg.n_workers = 0;
+        cilk_config_init(&cfg);
         cpu_set_t mask;
         // get the mask from the parent thread (master thread)
         pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask);
@@ -117,6 +158,8 @@ cilk_config_t cilk_thrd_config_from_env(const char* cilk_env_name) {
     value_filtered[value_filtered_len++] = 0; // add null terminator.
 
     int nworkers = 0;
+    cilk_config_t cfg;
+    cilk_config_init(&cfg);
     cpu_set_t cilk_mask;
     CPU_ZERO(&cilk_mask);
 
@@ -154,6 +197,12 @@ cilk_config_t cilk_thrd_config_from_env(const char* cilk_env_name) {
             nworkers = atoi(buffer);
             free(buffer);                        
         }
+        if (strcmp(name, "prewarm") == 0)
+            cfg.fiber_prewarm = config_number(cilk_env_name, name, data);
+        if (strcmp(name, "prewarmglobal") == 0)
+            cfg.fiber_prewarm_global = config_number(cilk_env_name, name, data);
+        if (strcmp(name, "prefault") == 0)
+            cfg.stack_prefault = config_number(cilk_env_name, name, data);
         if (strcmp(name, "cpuset") == 0) {
             int data_len = strlen(data);
 
@@ -192,7 +241,6 @@ cilk_config_t cilk_thrd_config_from_env(const char* cilk_env_name) {
         }
     } while ((token = strtok_r(NULL, ";", &ptr)));
 
-    cilk_config_t cfg;
     cfg.n_workers = nworkers;
     cfg.boss_affinity = cilk_mask;
     return cfg;
@@ -361,6 +409,11 @@ void __cilkrts_pause_frame(__cilkrts_stack_frame *sf, char *exn) {
     CILK_ASSERT(w, sf->worker == __cilkrts_get_tls_worker());
 
     CILK_ASSERT(w, sf->flags & CILK_FRAME_DETACHED);
+    if (w->serial) {
+        // The parent was never pushed; see __cilkrts_detach.
+        sf->flags &= ~CILK_FRAME_DETACHED;
+        return;
+    }
     __cilkrts_stack_frame **tail =
         atomic_load_explicit(&w->tail, memory_order_relaxed);
     --tail;
@@ -390,6 +443,12 @@ void __cilkrts_leave_frame(__cilkrts_stack_frame *sf) {
     // WHEN_CILK_DEBUG(sf->magic = ~CILK_STACKFRAME_MAGIC);
 
     if (sf->flags & CILK_FRAME_DETACHED) { // if this frame is detached
+        if (w->serial) {
+            // Nothing was pushed and no thief can race with us, so there is
+            // no Dekker protocol to run.
+            sf->flags &= ~CILK_FRAME_DETACHED;
+            return;
+        }
         __cilkrts_stack_frame **tail =
             atomic_load_explicit(&w->tail, memory_order_relaxed);
         --tail;
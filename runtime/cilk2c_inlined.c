@@ -15,6 +15,7 @@
 #include "fiber.h"
 #include "global.h"
 #include "init.h"
+#include "park.h"
 #include "readydeque.h"
 #include "scheduler.h"
 
@@ -201,14 +202,28 @@ void __cilkrts_detach(__cilkrts_stack_frame *sf) {
 
     struct __cilkrts_stack_frame *parent = sf->call_parent;
     sf->flags |= CILK_FRAME_DETACHED;
+    // No thief can take the parent from a serial worker.
+    if (w->serial)
+        return;
     struct __cilkrts_stack_frame **tail =
         atomic_load_explicit(&w->tail, memory_order_relaxed);
-    CILK_ASSERT(w, (tail + 1) < w->ltq_limit);
+    if (__builtin_expect((tail + 1) >= w->ltq_limit, 0))
+        tail = __cilkrts_grow_shadow_stack(w);
 
     // store parent at *tail, and then increment tail
     *tail++ = parent;
     /* Release ordering ensures the two preceding stores are visible. */
     atomic_store_explicit(&w->tail, tail, memory_order_release);
+
+    // If the deque was empty, idle workers may have parked.  The fence
+    // orders the store to tail before the load of nparked; see park.c.
+    if (__builtin_expect(atomic_load_explicit(&w->head, memory_order_relaxed) >=
+                             tail - 1,
+                         0)) {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_load_explicit(&w->g->nparked, memory_order_relaxed))
+            __cilkrts_wake_thief(w);
+    }
 }
 
 // inlined by the compiler; this implementation is only used in invoke-main.c
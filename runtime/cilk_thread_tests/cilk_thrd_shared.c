@@ -0,0 +1,97 @@
+#define _GNU_SOURCE
+#include <sched.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+#include "util.h"
+#include <cilk/cilk_c11_threads.h>
+#include <sys/time.h>
+
+// Threads attached to one shared runtime, all running Cilkified regions on
+// its workers at once.
+
+#define NTHREADS 8
+
+static cilk_runtime_t shared_runtime;
+
+void *attached_fib(void *n) {
+    cilk_thrd_attach(shared_runtime);
+    long ok = 1;
+    for (int i = 0; i < 10; i++)
+        ok &= fib(*(int *)n) == 832040;
+    return (void *)ok;
+}
+
+bool threads_share_runtime(int max_roots) {
+    pthread_t threads[NTHREADS];
+    int arg = 30;
+    for (int i = 0; i < NTHREADS; i++) {
+        int res = pthread_create(&threads[i], NULL, attached_fib, &arg);
+        assert(res == 0);
+    }
+    bool ok = fib(arg) == 832040;
+    for (int i = 0; i < NTHREADS; i++) {
+        void *answer;
+        int res = pthread_join(threads[i], &answer);
+        assert(res == 0);
+        ok &= (long)answer;
+    }
+    return ok;
+}
+
+int dispatch_fib(void *n) {
+    return fib(*(int *)n);
+}
+
+bool async_fibs_complete(int max_roots) {
+    cilk_future_t futures[2 * NTHREADS];
+    int arg = 30;
+    for (int i = 0; i < 2 * NTHREADS; i++) {
+        int res = cilk_thrd_async(shared_runtime, &futures[i], dispatch_fib, &arg);
+        assert(res == cilk_thrd_success);
+    }
+    bool ok = true;
+    for (int i = 0; i < 2 * NTHREADS; i++) {
+        int answer = 0;
+        int res = cilk_future_wait(futures[i], &answer);
+        assert(res == cilk_thrd_success);
+        ok &= answer == 832040;
+    }
+    return ok;
+}
+
+bool stats_count_steals(int max_roots) {
+    cilk_runtime_stats_t stats;
+    cilk_thrd_take_stats(shared_runtime, &stats);
+    bool ok = threads_share_runtime(max_roots);
+    cilk_thrd_take_stats(shared_runtime, &stats);
+    return ok && stats.steals > 0 && stats.fibers_allocated > 0;
+}
+
+// Run by a new thread, since the main thread already has the default runtime.
+void *shared_runtime_tests(void *n) {
+    int max_roots = *(int *)n;
+    cilk_config_t cfg;
+    cfg.n_workers = 4;
+    sched_getaffinity(0, sizeof(cfg.boss_affinity), &cfg.boss_affinity);
+    cilk_thrd_init_shared(cfg, max_roots);
+    shared_runtime = cilk_thrd_runtime();
+
+    run_test("threads_share_runtime", threads_share_runtime, max_roots);
+    run_test("async_fibs_complete", async_fibs_complete, max_roots);
+    run_test("stats_count_steals", stats_count_steals, max_roots);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    printf("Running shared runtime tests...\n");
+    int max_roots[] = {1, 4, NTHREADS + 1};
+    for (int i = 0; i < 3; i++) {
+        pthread_t thread;
+        pthread_create(&thread, NULL, shared_runtime_tests, &max_roots[i]);
+        pthread_join(thread, NULL);
+    }
+    return 0;
+}
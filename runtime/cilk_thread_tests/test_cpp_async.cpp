@@ -0,0 +1,49 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <cilk/cilk.h>
+#include <cilk/cilk_api.h>
+#include <cilk/cilk_cpp_threads.hpp>
+
+using namespace std;
+
+int fib(int n) {
+    if (n < 2)
+        return n;
+    int x = cilk_spawn fib(n - 1);
+    int y = fib(n - 2);
+    cilk_sync;
+    return x + y;
+}
+
+int main() {
+	cout << "Starting cpp async test " << endl;
+	bool ok = true;
+
+	// cilk_async needs a shared runtime, which this thread creates.
+	thread owner([&ok] {
+		cilk_config_t config;
+		config.n_workers = 4;
+		sched_getaffinity(0, sizeof(config.boss_affinity), &config.boss_affinity);
+		cilk_thrd_init_shared(config, 4);
+		cilk_runtime_t runtime = cilk_thrd_runtime();
+
+		vector<future<int>> results;
+		for (int i = 0; i < 16; i++)
+			results.push_back(cilk_async(runtime, fib, 25 + i % 4));
+		future<void> thrown = cilk_async(runtime, [] { throw runtime_error("thrown"); });
+
+		int expected[] = {75025, 121393, 196418, 317811};
+		for (int i = 0; i < 16; i++)
+			ok &= results[i].get() == expected[i % 4];
+		try {
+			thrown.get();
+			ok = false;
+		} catch (runtime_error &) {
+		}
+	});
+	owner.join();
+
+	cout << "TEST: cilk_async = " << (ok ? "PASS" : "FAIL") << endl;
+	return ok ? 0 : 1;
+}
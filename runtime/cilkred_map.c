@@ -221,6 +221,34 @@ void cilkred_map_merge(cilkred_map *this_map, __cilkrts_worker *w,
     return;
 }
 
+/* Reduce every view in this_map into the leftmost view of its reducer, i.e.,
+   the view embedded in the reducer object, and destroy this_map. */
+void cilkred_map_reduce_into_leftmost(cilkred_map *this_map,
+                                      __cilkrts_worker *w) {
+    this_map->merging = true;
+    bool use_log = this_map->num_of_logs <= (this_map->spa_cap / 2);
+    hyper_id_t n = use_log ? this_map->num_of_logs : this_map->spa_cap;
+    for (hyper_id_t i = 0; i < n; i++) {
+        hyper_id_t vindex = use_log ? this_map->log[i] : i;
+        ViewInfo *view = &this_map->vinfo[vindex];
+        __cilkrts_hyperobject_base *key = view->key;
+        if (key == NULL)
+            continue;
+        void *leftmost = (char *)key + (ptrdiff_t)key->__view_offset;
+        if (view->val != leftmost) {
+            key->__c_monoid.reduce_fn(key, leftmost, view->val);
+            clear_view(view);
+        } else {
+            view->key = NULL;
+            view->val = NULL;
+        }
+    }
+    this_map->num_of_vinfo = 0;
+    this_map->num_of_logs = 0;
+    this_map->merging = false;
+    cilkred_map_destroy_map(w, this_map);
+}
+
 /** @brief Test whether the cilkred_map is empty */
 bool cilkred_map_is_empty(cilkred_map *this_map) {
     return this_map->num_of_vinfo == 0;
@@ -82,6 +82,14 @@ CHEETAH_INTERNAL
 void cilkred_map_merge(cilkred_map *this_map, __cilkrts_worker *w,
                        cilkred_map *other_map, merge_kind kind);
 
+/**
+ * Reduce every view in this_map into the leftmost view of its reducer and
+ * destroy this_map.
+ */
+CHEETAH_INTERNAL
+void cilkred_map_reduce_into_leftmost(cilkred_map *this_map,
+                                      __cilkrts_worker *w);
+
 /** @brief Test whether the cilkred_map is empty */
 CHEETAH_INTERNAL
 bool cilkred_map_is_empty(cilkred_map *this_map);
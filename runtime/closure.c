@@ -3,6 +3,7 @@
 #include "cilk2c.h"
 #include "global.h"
 #include "internal-malloc.h"
+#include "local.h"
 #include "readydeque.h"
 
 #undef Closure_assert_ownership
@@ -113,7 +114,7 @@ static inline void Closure_init(Closure *t) {
     cilk_mutex_init(&t->mutex);
 
     t->mutex_owner = NO_WORKER;
-    t->owner_ready_deque = NO_WORKER;
+    Closure_set_owner_deque(t, NO_WORKER);
     t->status = CLOSURE_PRE_INVALID;
     t->lock_wait = false;
     t->has_cilk_callee = false;
@@ -126,6 +127,7 @@ static inline void Closure_init(Closure *t) {
 
     t->orig_rsp = NULL;
 
+    t->root = NULL;
     t->callee = NULL;
 
     t->call_parent = NULL;
@@ -328,7 +330,7 @@ void Closure_suspend_victim(__cilkrts_worker *thief, __cilkrts_worker *victim,
     Closure_assert_ownership(thief, cl);
     deque_assert_ownership(thief, victim->self);
 
-    CILK_ASSERT(thief, cl == thief->g->root_closure || cl->spawn_parent ||
+    CILK_ASSERT(thief, cl->root || cl->spawn_parent ||
                            cl->call_parent);
 
     Closure_change_status(thief, cl, CLOSURE_RUNNING, CLOSURE_SUSPENDED);
@@ -350,7 +352,7 @@ void Closure_suspend(__cilkrts_worker *const w, Closure *cl) {
     Closure_assert_ownership(w, cl);
     deque_assert_ownership(w, w->self);
 
-    CILK_ASSERT(w, cl == w->g->root_closure || cl->spawn_parent ||
+    CILK_ASSERT(w, cl->root || cl->spawn_parent ||
                        cl->call_parent);
     CILK_ASSERT(w, cl->frame != NULL);
     CILK_ASSERT(w, __cilkrts_stolen(cl->frame));
@@ -387,6 +389,10 @@ static inline void Closure_clean(__cilkrts_worker *const w, Closure *t) {
         CILK_ASSERT_G(t->right_rmap == (cilkred_map *)NULL);
     }
 
+#if CILK_MUTEX_STATS
+    if (w)
+        cilk_mutex_stats_add(&w->l->closure_lock_stats, &t->mutex);
+#endif
     cilk_mutex_destroy(&t->mutex);
 }
 
@@ -11,6 +11,7 @@
 
 // Forward declaration
 typedef struct Closure Closure;
+struct cilk_root;
 
 enum ClosureStatus {
     /* Closure.status == 0 is invalid */
@@ -55,8 +56,8 @@ struct Closure {
     struct cilk_fiber *fiber;
     struct cilk_fiber *fiber_child;
 
-    worker_id owner_ready_deque; /* debug only */
-    worker_id mutex_owner;       /* debug only */
+    _Atomic(worker_id) owner_ready_deque; /* whose deque holds this, if any */
+    worker_id mutex_owner;                /* debug only */
 
     enum ClosureStatus status : 8; /* doubles as magic number */
     bool has_cilk_callee;
@@ -65,6 +66,8 @@ struct Closure {
     unsigned int join_counter; /* number of outstanding spawned children */
     char *orig_rsp; /* the rsp one should use when sync successfully */
 
+    struct cilk_root *root; /* set if this is the root closure of a region */
+
     Closure *callee;
 
     Closure *call_parent;  /* the "parent" closure that called */
@@ -123,6 +126,16 @@ struct Closure {
 
 } __attribute__((aligned(CILK_CACHE_LINE)));
 
+// owner_ready_deque is written under the deque lock, but leapfrogging reads
+// it without any lock.  It is only a hint there, so relaxed accesses do.
+static inline worker_id Closure_owner_deque(Closure *cl) {
+    return atomic_load_explicit(&cl->owner_ready_deque, memory_order_relaxed);
+}
+
+static inline void Closure_set_owner_deque(Closure *cl, worker_id pn) {
+    atomic_store_explicit(&cl->owner_ready_deque, pn, memory_order_relaxed);
+}
+
 #if CILK_DEBUG
 CHEETAH_INTERNAL void Closure_assert_ownership(__cilkrts_worker *const w,
                                                Closure *t);
@@ -13,7 +13,7 @@ struct __cilkrts_worker;
     ((cond) ? (void)0 : cilk_die_internal(g, complain, __VA_ARGS__))
 
 #ifndef ALERT_LVL
-#define ALERT_LVL 0x3d03
+#define ALERT_LVL 0xbd03
 #endif
 #define ALERT_NONE 0x0
 #define ALERT_FIBER 0x001
@@ -30,6 +30,7 @@ struct __cilkrts_worker;
 #define ALERT_BOOT 0x1000
 #define ALERT_START 0x2000
 #define ALERT_CLOSURE 0x4000
+#define ALERT_SCHED_SUMMARY 0x8000
 
 extern CHEETAH_INTERNAL unsigned int alert_level;
 #define ALERT_ENABLED(flag) (alert_level & (ALERT_LVL & ALERT_##flag))
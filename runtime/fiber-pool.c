@@ -1,4 +1,6 @@
 #include <inttypes.h> /* PRIu32 */
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -7,20 +9,32 @@
 #include "fiber.h"
 #include "global.h"
 #include "local.h"
-#include "mutex.h"
 
 // Whent the pool becomes full (empty), free (allocate) this fraction
 // of the pool back to (from) parent / the OS.
 #define BATCH_FRACTION 2
 #define GLOBAL_POOL_RATIO 10 // make global pool this much larger
 
+// Per-worker pools are resized between Cilkified regions, between
+// fiber_pool_cap / ADAPT_SHRINK_LIMIT and fiber_pool_cap * ADAPT_GROW_LIMIT.
+// A pool that took fibers from or gave fibers to its parent during a region
+// doubles.  A pool whose size stayed within a quarter of its capacity for
+// ADAPT_QUIET_REGIONS regions in a row halves.
+#define ADAPT_GROW_LIMIT 8
+#define ADAPT_SHRINK_LIMIT 4
+#define ADAPT_QUIET_REGIONS 4
+
+// The bottom of a stack of slots in struct fiber_slots
+#define SLOT_NIL UINT32_MAX
+
 //=========================================================================
 // Currently the fiber pools are organized into two-levels, like in Hoard
 // --- per-worker private pool plus a global pool.  The per-worker private
 // pool are accessed by the owner worker only and thus do not require
-// synchronization.  The global pool may be accessed concurrently and thus
-// require synchronization.  Thus, the pool->lock is initialized to NULL for
-// per-worker pools and cilk_mutex for the global one.
+// synchronization.  The global pool may be accessed concurrently.  It is
+// lock-free: its free fibers and its empty slots are two Treiber stacks of
+// slot indices (see struct fiber_slots).  The slots array never moves, so a
+// worker reading a stale slot index only loses its compare-and-swap.
 //
 // The per-worker pools are initlaized with some free fibers preallocated
 // already and the global one starts out empty.  A worker typically acquires
@@ -41,21 +55,42 @@ static void fiber_pool_stat_init(struct cilk_fiber_pool *pool) {
     pool->stats.in_use = 0;
     pool->stats.max_in_use = 0;
     pool->stats.max_free = 0;
+    pool->stats.max_resident = pool->stats.resident;
+}
+
+// Account for the resident stack of a fiber entering or leaving the pool.
+static inline void fiber_pool_add_resident(struct cilk_fiber_pool *pool,
+                                           struct cilk_fiber *fiber) {
+    pool->stats.resident += cilk_fiber_resident(fiber);
+    if (pool->stats.resident > pool->stats.max_resident) {
+        pool->stats.max_resident = pool->stats.resident;
+    }
 }
 
-#define POOL_FMT "size %3u, %4d used %4d max used %4u max free"
+static inline void fiber_pool_sub_resident(struct cilk_fiber_pool *pool,
+                                           struct cilk_fiber *fiber) {
+    pool->stats.resident -= cilk_fiber_resident(fiber);
+}
+
+#define POOL_FMT                                                               \
+    "capacity %4u, size %3u, %4d used %4d max used %4u max free %8zu KiB "    \
+    "resident %8zu KiB max resident"
 
 static void fiber_pool_stat_print_worker(__cilkrts_worker *w, void *data) {
     FILE *fp = (FILE *)data;
     fprintf(fp, "[W%02" PRIu32 "] " POOL_FMT "\n", w->self,
-            w->l->fiber_pool.size, w->l->fiber_pool.stats.in_use,
-            w->l->fiber_pool.stats.max_in_use, w->l->fiber_pool.stats.max_free);
+            w->l->fiber_pool.capacity, w->l->fiber_pool.size, w->l->fiber_pool.stats.in_use,
+            w->l->fiber_pool.stats.max_in_use, w->l->fiber_pool.stats.max_free,
+            w->l->fiber_pool.stats.resident / 1024,
+            w->l->fiber_pool.stats.max_resident / 1024);
 }
 
 static void fiber_pool_stat_print(struct global_state *g) {
     fprintf(stderr, "\nFIBER POOL STATS\n[G  ] " POOL_FMT "\n",
-            g->fiber_pool.size, g->fiber_pool.stats.in_use,
-            g->fiber_pool.stats.max_in_use, g->fiber_pool.stats.max_free);
+            g->fiber_pool.capacity, g->fiber_pool.size, g->fiber_pool.stats.in_use,
+            g->fiber_pool.stats.max_in_use, g->fiber_pool.stats.max_free,
+            g->fiber_pool.stats.resident / 1024,
+            g->fiber_pool.stats.max_resident / 1024);
     for_each_worker(g, &fiber_pool_stat_print_worker, stderr);
     fprintf(stderr, "\n");
 }
@@ -76,65 +111,166 @@ static void fiber_pool_free_batch(__cilkrts_worker *w,
 static void fiber_pool_init(struct cilk_fiber_pool *pool, size_t stacksize,
                             unsigned int bufsize,
                             struct cilk_fiber_pool *parent, int is_shared) {
-    cilk_mutex_init(&pool->lock);
-    pool->mutex_owner = NO_WORKER;
     pool->shared = is_shared;
     pool->stack_size = stacksize;
     pool->parent = parent;
     pool->capacity = bufsize;
     pool->size = 0;
+    pool->stats.resident = 0;
+    pool->refills = pool->spills = 0;
+    pool->low = pool->high = 0;
+    pool->quiet_regions = 0;
     pool->fibers = calloc(bufsize, sizeof(*pool->fibers));
+    pool->slots.next = NULL;
+    if (is_shared) {
+        // Every slot starts out empty.
+        struct fiber_slots *slots = &pool->slots;
+        slots->next = calloc(bufsize, sizeof(*slots->next));
+        for (unsigned int i = 0; i < bufsize; i++) {
+            atomic_init(&slots->next[i], i + 1 < bufsize ? i + 1 : SLOT_NIL);
+        }
+        atomic_init(&slots->empty, bufsize ? 0 : SLOT_NIL);
+        atomic_init(&slots->full, SLOT_NIL);
+        atomic_init(&slots->size, 0);
+        atomic_init(&slots->max_free, 0);
+        atomic_init(&slots->in_use, 0);
+        atomic_init(&slots->max_in_use, 0);
+        atomic_init(&slots->resident, 0);
+        atomic_init(&slots->max_resident, 0);
+    }
 }
 
 /* Helper function for destroying fiber pool */
 static void fiber_pool_destroy(struct cilk_fiber_pool *pool) {
     CILK_ASSERT_G(pool->size == 0);
-    cilk_mutex_destroy(&pool->lock);
+    free(pool->slots.next);
     free(pool->fibers);
     pool->parent = NULL;
     pool->fibers = NULL;
+    pool->slots.next = NULL;
 }
 
-static inline void fiber_pool_assert_ownership(__cilkrts_worker *w,
-                                               struct cilk_fiber_pool *pool) {
-    if (pool->shared)
-        CILK_ASSERT(w, pool->mutex_owner == w->self);
+//=========================================================
+// The lock-free shared pool
+//=========================================================
+
+// A head for old's stack with slot on top and the next tag
+static inline uint64_t slot_head(uint64_t old, uint32_t slot) {
+    return (((old >> 32) + 1) << 32) | slot;
 }
 
-static inline void fiber_pool_assert_alienation(__cilkrts_worker *w,
-                                                struct cilk_fiber_pool *pool) {
-    if (pool->shared)
-        CILK_ASSERT(w, pool->mutex_owner != w->self);
+// Pop a slot off the stack at head.  Returns SLOT_NIL if it is empty.
+// Failed compare-and-swaps are added to *retries.
+static uint32_t slot_pop(_Atomic uint64_t *head, _Atomic uint32_t *next,
+                         uint64_t *retries) {
+    uint64_t old = atomic_load_explicit(head, memory_order_acquire);
+    while ((uint32_t)old != SLOT_NIL) {
+        uint32_t slot = (uint32_t)old;
+        // The slot may be popped and pushed again meanwhile, so this read
+        // may be stale.  The tag in the head then fails the exchange.
+        uint32_t below =
+            atomic_load_explicit(&next[slot], memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(
+                head, &old, slot_head(old, below), memory_order_acquire,
+                memory_order_acquire))
+            return slot;
+        ++*retries;
+    }
+    return SLOT_NIL;
 }
 
-static inline void fiber_pool_lock(__cilkrts_worker *w,
-                                   struct cilk_fiber_pool *pool) {
-    if (pool->shared) {
-        fiber_pool_assert_alienation(w, pool);
-        cilk_mutex_lock(&pool->lock);
-        pool->mutex_owner = w->self;
+static void slot_push(_Atomic uint64_t *head, _Atomic uint32_t *next,
+                      uint32_t slot, uint64_t *retries) {
+    uint64_t old = atomic_load_explicit(head, memory_order_relaxed);
+    while (true) {
+        atomic_store_explicit(&next[slot], (uint32_t)old,
+                              memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(
+                head, &old, slot_head(old, slot), memory_order_release,
+                memory_order_relaxed))
+            return;
+        ++*retries;
     }
 }
 
-static inline void fiber_pool_unlock(__cilkrts_worker *w,
-                                     struct cilk_fiber_pool *pool) {
-    if (pool->shared) {
-        fiber_pool_assert_ownership(w, pool);
-        pool->mutex_owner = NO_WORKER;
-        cilk_mutex_unlock(&pool->lock);
+static void slots_stat_max(atomic_long *max, long v) {
+    long old = atomic_load_explicit(max, memory_order_relaxed);
+    while (v > old && !atomic_compare_exchange_weak_explicit(
+                          max, &old, v, memory_order_relaxed,
+                          memory_order_relaxed)) {
     }
 }
 
+// Take a free fiber from the shared pool, or return NULL if it has none.
+static struct cilk_fiber *shared_pool_get(struct cilk_fiber_pool *pool,
+                                          uint64_t *retries) {
+    struct fiber_slots *slots = &pool->slots;
+    uint32_t slot = slot_pop(&slots->full, slots->next, retries);
+    if (slot == SLOT_NIL)
+        return NULL;
+    struct cilk_fiber *fiber = pool->fibers[slot];
+    slot_push(&slots->empty, slots->next, slot, retries);
+    atomic_fetch_sub_explicit(&slots->size, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&slots->resident,
+                              (long)cilk_fiber_resident(fiber),
+                              memory_order_relaxed);
+    return fiber;
+}
+
+// Put fiber in the shared pool.  Returns false if the pool is full.
+static bool shared_pool_put(struct cilk_fiber_pool *pool,
+                            struct cilk_fiber *fiber, uint64_t *retries) {
+    struct fiber_slots *slots = &pool->slots;
+    uint32_t slot = slot_pop(&slots->empty, slots->next, retries);
+    if (slot == SLOT_NIL)
+        return false;
+    // Read before the fiber is published and may be taken
+    long bytes = (long)cilk_fiber_resident(fiber);
+    pool->fibers[slot] = fiber;
+    slot_push(&slots->full, slots->next, slot, retries);
+    slots_stat_max(&slots->max_free,
+                   atomic_fetch_add_explicit(&slots->size, 1,
+                                             memory_order_relaxed) + 1);
+    slots_stat_max(&slots->max_resident,
+                   atomic_fetch_add_explicit(&slots->resident, bytes,
+                                             memory_order_relaxed) + bytes);
+    return true;
+}
+
+// Count n fibers taken from (n > 0) or returned to the shared pool.
+static void shared_pool_count_use(struct cilk_fiber_pool *pool, long n) {
+    struct fiber_slots *slots = &pool->slots;
+    slots_stat_max(&slots->max_in_use,
+                   atomic_fetch_add_explicit(&slots->in_use, n,
+                                             memory_order_relaxed) + n);
+}
+
+// Copy the shared pool's counts into its size and stats, once workers have
+// stopped using it.
+static void shared_pool_sync_stats(struct cilk_fiber_pool *pool) {
+    struct fiber_slots *slots = &pool->slots;
+    pool->size = atomic_load_explicit(&slots->size, memory_order_relaxed);
+    pool->stats.max_free =
+        atomic_load_explicit(&slots->max_free, memory_order_relaxed);
+    pool->stats.in_use =
+        atomic_load_explicit(&slots->in_use, memory_order_relaxed);
+    pool->stats.max_in_use =
+        atomic_load_explicit(&slots->max_in_use, memory_order_relaxed);
+    pool->stats.resident =
+        atomic_load_explicit(&slots->resident, memory_order_relaxed);
+    pool->stats.max_resident =
+        atomic_load_explicit(&slots->max_resident, memory_order_relaxed);
+}
+
 /**
  * Increase the buffer size for the free fibers.  If the current size is
- * already larger than the new size, do nothing.  Assume lock acquired upon
- * entry.
+ * already larger than the new size, do nothing.  Only for private pools.
  */
 static void fiber_pool_increase_capacity(__cilkrts_worker *w,
                                          struct cilk_fiber_pool *pool,
                                          unsigned int new_size) {
 
-    fiber_pool_assert_ownership(w, pool);
+    CILK_ASSERT(w, !pool->shared);
 
     if (pool->capacity < new_size) {
         struct cilk_fiber **larger =
@@ -148,15 +284,13 @@ static void fiber_pool_increase_capacity(__cilkrts_worker *w,
 
 /**
  * Decrease the buffer size for the free fibers.  If the current size is
- * already smaller than the new size, do nothing.  Assume lock acquired upon
- * entry.
+ * already smaller than the new size, do nothing.  Only for private pools.
  */
-__attribute__((unused)) // unused for now
 static void
 fiber_pool_decrease_capacity(__cilkrts_worker *w, struct cilk_fiber_pool *pool,
                              unsigned int new_size) {
 
-    fiber_pool_assert_ownership(w, pool);
+    CILK_ASSERT(w, !pool->shared);
 
     if (pool->size > new_size) {
         int diff = pool->size - new_size;
@@ -181,28 +315,28 @@ fiber_pool_decrease_capacity(__cilkrts_worker *w, struct cilk_fiber_pool *pool,
 static void fiber_pool_allocate_batch(__cilkrts_worker *w,
                                       struct cilk_fiber_pool *pool,
                                       const unsigned int batch_size) {
-    fiber_pool_assert_ownership(w, pool);
     fiber_pool_increase_capacity(w, pool, batch_size + pool->size);
 
     unsigned int from_parent = 0;
     if (pool->parent) {
         struct cilk_fiber_pool *parent = pool->parent;
-        fiber_pool_lock(w, parent);
-        from_parent = parent->size <= batch_size ? parent->size : batch_size;
-        for (unsigned int i = 0; i < from_parent; i++) {
-            pool->fibers[pool->size++] = parent->fibers[--parent->size];
-        }
-        // update parent pool stats before releasing the lock on it
-        parent->stats.in_use += from_parent;
-        if (parent->stats.in_use > parent->stats.max_in_use) {
-            parent->stats.max_in_use = parent->stats.in_use;
+        uint64_t retries = 0;
+        for (; from_parent < batch_size; from_parent++) {
+            struct cilk_fiber *fiber = shared_pool_get(parent, &retries);
+            if (!fiber)
+                break;
+            fiber_pool_add_resident(pool, fiber);
+            pool->fibers[pool->size++] = fiber;
         }
-        fiber_pool_unlock(w, parent);
+        shared_pool_count_use(parent, from_parent);
+        CILK_COUNT(w, COUNTER_POOL_GLOBAL);
+        CILK_COUNT_N(w, COUNTER_POOL_RETRY, retries);
     }
     if (batch_size > from_parent) { // if we need more still
         for (unsigned int i = from_parent; i < batch_size; i++) {
-            pool->fibers[pool->size++] =
-                cilk_fiber_allocate(w, pool->stack_size);
+            struct cilk_fiber *fiber = cilk_fiber_allocate(w, pool->stack_size);
+            fiber_pool_add_resident(pool, fiber);
+            pool->fibers[pool->size++] = fiber;
         }
     }
     if (pool->size > pool->stats.max_free) {
@@ -218,30 +352,28 @@ static void fiber_pool_free_batch(__cilkrts_worker *w,
                                   struct cilk_fiber_pool *pool,
                                   const unsigned int batch_size) {
 
-    fiber_pool_assert_ownership(w, pool);
     CILK_ASSERT(w, batch_size <= pool->size);
 
     unsigned int to_parent = 0;
     if (pool->parent) { // first try to free into the parent
         struct cilk_fiber_pool *parent = pool->parent;
-        fiber_pool_lock(w, parent);
-        to_parent = (batch_size <= (parent->capacity - parent->size))
-                        ? batch_size
-                        : (parent->capacity - parent->size);
+        uint64_t retries = 0;
         // free what we can within the capacity of the parent pool
-        for (unsigned int i = 0; i < to_parent; i++) {
-            parent->fibers[parent->size++] = pool->fibers[--pool->size];
+        for (; to_parent < batch_size; to_parent++) {
+            struct cilk_fiber *fiber = pool->fibers[pool->size - 1];
+            if (!shared_pool_put(parent, fiber, &retries))
+                break;
+            --pool->size;
+            fiber_pool_sub_resident(pool, fiber);
         }
-        CILK_ASSERT(w, parent->size <= parent->capacity);
-        parent->stats.in_use -= to_parent;
-        if (parent->size > parent->stats.max_free) {
-            parent->stats.max_free = parent->size;
-        }
-        fiber_pool_unlock(w, parent);
+        shared_pool_count_use(parent, -(long)to_parent);
+        CILK_COUNT(w, COUNTER_POOL_GLOBAL);
+        CILK_COUNT_N(w, COUNTER_POOL_RETRY, retries);
     }
     if ((batch_size - to_parent) > 0) { // still need to free more
         for (unsigned int i = to_parent; i < batch_size; i++) {
             struct cilk_fiber *fiber = pool->fibers[--pool->size];
+            fiber_pool_sub_resident(pool, fiber);
             cilk_fiber_deallocate(w, fiber);
         }
     }
@@ -256,6 +388,7 @@ void cilk_fiber_pool_global_init(global_state *g) {
 
     unsigned int bufsize = GLOBAL_POOL_RATIO * g->options.fiber_pool_cap;
     struct cilk_fiber_pool *pool = &(g->fiber_pool);
+    cilk_stack_arena_init(&g->stack_arena, g->options.stacksize);
     fiber_pool_init(pool, g->options.stacksize, bufsize, NULL, 1 /*shared*/);
     CILK_ASSERT_G(NULL != pool->fibers);
     fiber_pool_stat_init(pool);
@@ -267,12 +400,12 @@ void cilk_fiber_pool_global_init(global_state *g) {
  */
 void cilk_fiber_pool_global_terminate(global_state *g) {
     struct cilk_fiber_pool *pool = &g->fiber_pool;
-    cilk_mutex_lock(&pool->lock); /* probably not needed */
-    while (pool->size > 0) {
-        struct cilk_fiber *fiber = pool->fibers[--pool->size];
+    struct cilk_fiber *fiber;
+    uint64_t retries = 0;
+    while ((fiber = shared_pool_get(pool, &retries))) {
         cilk_fiber_deallocate_global(g, fiber);
     }
-    cilk_mutex_unlock(&pool->lock);
+    shared_pool_sync_stats(pool);
     if (ALERT_ENABLED(FIBER_SUMMARY))
         fiber_pool_stat_print(g);
 }
@@ -280,6 +413,7 @@ void cilk_fiber_pool_global_terminate(global_state *g) {
 /* Global fiber pool clean up. */
 void cilk_fiber_pool_global_destroy(global_state *g) {
     fiber_pool_destroy(&g->fiber_pool); // worker 0 should have freed everything
+    cilk_stack_arena_destroy(&g->stack_arena);
 }
 
 /**
@@ -295,8 +429,53 @@ void cilk_fiber_pool_per_worker_init(__cilkrts_worker *w) {
     CILK_ASSERT(w, NULL != pool->fibers);
     CILK_ASSERT(w, w->g->fiber_pool.stack_size == pool->stack_size);
 
-    fiber_pool_allocate_batch(w, pool, bufsize / BATCH_FRACTION);
+    // With prewarming, the worker fills its pool on its own thread.
+    if (!w->g->options.fiber_prewarm && !w->g->options.fiber_prewarm_global)
+        fiber_pool_allocate_batch(w, pool, bufsize / BATCH_FRACTION);
     fiber_pool_stat_init(pool);
+    pool->low = pool->high = pool->size;
+}
+
+/**
+ * Fill w's pool with options.fiber_prewarm fibers, or with the number it is
+ * normally initialized with, and make w's share of the
+ * options.fiber_prewarm_global fibers for the global pool.  Called on w's
+ * own thread, so that the stacks are first touched on its NUMA node.  The
+ * top options.stack_prefault bytes of each stack are faulted in.
+ */
+void cilk_fiber_pool_per_worker_prewarm(__cilkrts_worker *w) {
+    global_state *g = w->g;
+    struct cilk_fiber_pool *pool = &(w->l->fiber_pool);
+    size_t prefault = g->options.stack_prefault;
+
+    unsigned int target = g->options.fiber_prewarm;
+    if (target == 0)
+        target = pool->capacity / BATCH_FRACTION;
+    if (target > pool->capacity)
+        target = pool->capacity;
+    while (pool->size < target) {
+        struct cilk_fiber *fiber = cilk_fiber_allocate(w, pool->stack_size);
+        cilk_fiber_prefault_stack(fiber, prefault);
+        fiber_pool_add_resident(pool, fiber);
+        pool->fibers[pool->size++] = fiber;
+    }
+    if (pool->size > pool->stats.max_free) {
+        pool->stats.max_free = pool->size;
+    }
+    pool->low = pool->high = pool->size;
+
+    unsigned int global = g->options.fiber_prewarm_global;
+    unsigned int share =
+        global / g->nworkers + (w->self < global % g->nworkers);
+    uint64_t retries = 0;
+    for (unsigned int i = 0; i < share; i++) {
+        struct cilk_fiber *fiber = cilk_fiber_allocate(w, pool->stack_size);
+        cilk_fiber_prefault_stack(fiber, prefault);
+        if (!shared_pool_put(&g->fiber_pool, fiber, &retries)) {
+            cilk_fiber_deallocate(w, fiber); // the global pool is full
+            break;
+        }
+    }
 }
 
 /* This does not yet destroy the fiber pool; merely collects
@@ -308,6 +487,7 @@ void cilk_fiber_pool_per_worker_terminate(__cilkrts_worker *w) {
         unsigned index = --pool->size;
         struct cilk_fiber *fiber = pool->fibers[index];
         pool->fibers[index] = NULL;
+        fiber_pool_sub_resident(pool, fiber);
         cilk_fiber_deallocate(w, fiber);
     }
 }
@@ -327,8 +507,13 @@ struct cilk_fiber *cilk_fiber_allocate_from_pool(__cilkrts_worker *w) {
     struct cilk_fiber_pool *pool = &(w->l->fiber_pool);
     if (pool->size == 0) {
         fiber_pool_allocate_batch(w, pool, pool->capacity / BATCH_FRACTION);
+        pool->refills++;
     }
     struct cilk_fiber *ret = pool->fibers[--pool->size];
+    if (pool->size < pool->low)
+        pool->low = pool->size;
+    fiber_pool_sub_resident(pool, ret);
+    CILK_COUNT(w, COUNTER_FIBER_ALLOC);
     pool->stats.in_use++;
     if (pool->stats.in_use > pool->stats.max_in_use) {
         pool->stats.max_in_use = pool->stats.in_use;
@@ -340,6 +525,9 @@ struct cilk_fiber *cilk_fiber_allocate_from_pool(__cilkrts_worker *w) {
 /**
  * Free fiber_to_return into this pool; if this pool is full,
  * free a batch of fibers back into the parent pool (or system).
+ * Pages of its stack below options.stack_reserve bytes are given
+ * back to the OS, so that a deep burst of work does not leave every
+ * pooled stack fully resident.
  */
 void cilk_fiber_deallocate_to_pool(__cilkrts_worker *w,
                                    struct cilk_fiber *fiber_to_return) {
@@ -348,9 +536,14 @@ void cilk_fiber_deallocate_to_pool(__cilkrts_worker *w,
         fiber_pool_free_batch(w, pool, pool->capacity / BATCH_FRACTION);
         CILK_ASSERT(w, (pool->capacity - pool->size) >=
                            (pool->capacity / BATCH_FRACTION));
+        pool->spills++;
     }
     if (fiber_to_return) {
+        cilk_fiber_release_stack(fiber_to_return, w->g->options.stack_reserve);
+        fiber_pool_add_resident(pool, fiber_to_return);
         pool->fibers[pool->size++] = fiber_to_return;
+        if (pool->size > pool->high)
+            pool->high = pool->size;
         pool->stats.in_use--;
         if (pool->size > pool->stats.max_free) {
             pool->stats.max_free = pool->size;
@@ -358,3 +551,51 @@ void cilk_fiber_deallocate_to_pool(__cilkrts_worker *w,
         fiber_to_return = NULL;
     }
 }
+
+/**
+ * Resize w's pool for the Cilkified region that just ended, if
+ * options.fiber_pool_adapt is set.  Called by w between regions.  A pool
+ * that kept running empty or full grows, so that a worker that often needs
+ * many fibers at once stops going to the global pool.  A pool that was
+ * mostly unused shrinks, and returns its extra fibers to the global pool.
+ */
+void cilk_fiber_pool_per_worker_adapt(__cilkrts_worker *w) {
+    struct cilk_fiber_pool *pool = &(w->l->fiber_pool);
+    unsigned int base = w->g->options.fiber_pool_cap;
+    if (!w->g->options.fiber_pool_adapt)
+        return;
+
+    if (pool->refills + pool->spills > 0) {
+        pool->quiet_regions = 0;
+        unsigned int new_size = pool->capacity * 2;
+        if (new_size > base * ADAPT_GROW_LIMIT)
+            new_size = base * ADAPT_GROW_LIMIT;
+        if (new_size > pool->capacity) {
+            cilkrts_alert(FIBER, w, "(adapt) fiber pool %u -> %u",
+                          pool->capacity, new_size);
+            fiber_pool_increase_capacity(w, pool, new_size);
+        }
+    } else if (++pool->quiet_regions >= ADAPT_QUIET_REGIONS) {
+        pool->quiet_regions = 0;
+        unsigned int min_size = base / ADAPT_SHRINK_LIMIT;
+        if (min_size < BATCH_FRACTION)
+            min_size = BATCH_FRACTION;
+        unsigned int new_size = pool->capacity / 2;
+        if (new_size < min_size)
+            new_size = min_size;
+        if (new_size < pool->capacity &&
+            pool->high - pool->low < pool->capacity / 4) {
+            cilkrts_alert(FIBER, w, "(adapt) fiber pool %u -> %u",
+                          pool->capacity, new_size);
+            // Keep as many fibers as a new pool starts with.
+            unsigned int keep = new_size / BATCH_FRACTION;
+            if (pool->size > keep)
+                fiber_pool_free_batch(w, pool, pool->size - keep);
+            fiber_pool_decrease_capacity(w, pool, new_size);
+        }
+    }
+    // The watermarks span the quiet regions since the last decision.
+    pool->refills = pool->spills = 0;
+    if (pool->quiet_regions == 0)
+        pool->low = pool->high = pool->size;
+}
@@ -8,6 +8,7 @@
 
 #include "cilk-internal.h"
 #include "fiber.h"
+#include "global.h"
 #include "init.h"
 
 #include <string.h> /* DEBUG */
@@ -17,7 +18,24 @@ struct cilk_fiber {
     char *stack_low;         // lowest usable byte of stack
     char *stack_high;        // one byte above highest usable byte of stack
     char *alloc_high;        // last byte of mmap-ed region
-    __cilkrts_worker *owner; // worker using this fiber
+    size_t resident;         // bytes of the stack that are resident; see
+                             // cilk_fiber_release_stack
+    struct stack_arena *arena; // where the stack came from, or NULL if it
+                               // was mapped by itself
+    __cilkrts_worker *owner;   // worker using this fiber
+};
+
+// A stack arena grows by chunks of this many stacks or, once larger, by as
+// many stacks as it has, up to the maximum.
+#define STACK_ARENA_MIN_CHUNK 32
+#define STACK_ARENA_MAX_CHUNK 1024
+
+// One mapping of an arena.
+struct stack_chunk {
+    char *base;
+    size_t length;
+    size_t nstacks;
+    struct stack_chunk *next;
 };
 
 #ifndef MAP_GROWSDOWN
@@ -29,6 +47,20 @@ struct cilk_fiber {
 #define MAP_STACK 0
 #endif
 
+/* Pages returned to the OS are reclaimed lazily with MADV_FREE, which is
+   cheaper when the stack is soon reused, or at once with MADV_DONTNEED. */
+#ifdef MADV_FREE
+#define STACK_RELEASE_ADVICE MADV_FREE
+#else
+#define STACK_RELEASE_ADVICE MADV_DONTNEED
+#endif
+
+/* Guard regions installed with madvise are markers in the page tables and
+   do not split the mapping (Linux 6.13 and later). */
+#if defined __linux__ && !defined MADV_GUARD_INSTALL
+#define MADV_GUARD_INSTALL 102
+#endif
+
 #define LOW_GUARD_PAGES 1
 #define HIGH_GUARD_PAGES 1
 
@@ -43,9 +75,9 @@ struct cilk_fiber {
 // Private helper functions
 //===============================================================
 
-static void make_stack(struct cilk_fiber *f, size_t stack_size) {
-    const int page_shift = cheetah_page_shift;
-    const size_t page_size = 1U << page_shift;
+// The pages of a stack of stack_size bytes, including two guard pages.
+static size_t stack_pages_for(size_t stack_size) {
+    const size_t page_size = 1U << cheetah_page_shift;
 
     size_t stack_pages = (stack_size + page_size - 1) >> cheetah_page_shift;
     stack_pages += LOW_GUARD_PAGES + HIGH_GUARD_PAGES;
@@ -57,6 +89,21 @@ static void make_stack(struct cilk_fiber *f, size_t stack_size) {
     } else if (stack_pages > MAX_NUM_PAGES_PER_STACK) {
         stack_pages = MAX_NUM_PAGES_PER_STACK;
     }
+    return stack_pages;
+}
+
+// The usable bytes of a stack of stack_size bytes, as rounded by make_stack.
+static size_t stack_bytes_for(size_t stack_size) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    return (stack_pages_for(stack_size) - LOW_GUARD_PAGES - HIGH_GUARD_PAGES) *
+           page_size;
+}
+
+static void make_stack(struct cilk_fiber *f, size_t stack_size) {
+    const int page_shift = cheetah_page_shift;
+    const size_t page_size = 1U << page_shift;
+
+    size_t stack_pages = stack_pages_for(stack_size);
     char *alloc_low = (char *)mmap(
         0, stack_pages * page_size, PROT_READ | PROT_WRITE,
         MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK | MAP_GROWSDOWN, -1, 0);
@@ -68,6 +115,7 @@ static void make_stack(struct cilk_fiber *f, size_t stack_size) {
         f->stack_low = NULL;
         f->stack_high = NULL;
         f->alloc_high = NULL;
+        f->resident = 0;
         return;
     }
     char *alloc_high = alloc_low + stack_pages * page_size;
@@ -80,20 +128,173 @@ static void make_stack(struct cilk_fiber *f, size_t stack_size) {
     f->stack_low = stack_low;
     f->stack_high = stack_high;
     f->alloc_high = alloc_high;
-    if (DEBUG_ENABLED(MEMORY_SLOW))
+    f->resident = 0;
+    if (DEBUG_ENABLED(MEMORY_SLOW)) {
         memset(stack_low, 0x11, stack_size);
+        f->resident = stack_high - stack_low;
+    }
+}
+
+//===============================================================
+// Stack arenas.  Mapping each stack by itself costs an mmap and two
+// mprotects and leaves three VMAs per fiber, which makes filling the pools
+// slow and runs into vm.max_map_count with large pools.  An arena maps
+// stacks in chunks instead, one guard page between neighbors:
+//
+//   | guard | stack 0 | guard | stack 1 | guard | ... | stack n-1 | guard |
+//
+// Where the kernel supports MADV_GUARD_INSTALL, the guard pages are
+// installed with it and a chunk of n stacks stays one VMA.  Otherwise they
+// are mprotected, which leaves 2n + 1 VMAs, still fewer than the 3n of
+// separate stacks.  Each guard page is below one stack and above another.
+// Stacks are not unmapped when freed but given back to the OS with
+// MADV_DONTNEED and kept for reuse until the runtime is destroyed.
+//===============================================================
+
+// Install the guard pages of a chunk as guard regions, or return false if
+// the kernel does not support them.
+static bool stack_chunk_guard_install(char *base, size_t slot, size_t n) {
+#ifdef MADV_GUARD_INSTALL
+    const size_t page_size = 1U << cheetah_page_shift;
+    for (size_t i = 0; i <= n; ++i) {
+        if (madvise(base + i * slot, page_size, MADV_GUARD_INSTALL) < 0) {
+            // Only the first call can fail for lack of support.
+            if (i == 0)
+                return false;
+            cilkrts_bug(NULL, "Cilk: stack arena guard install failed");
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Map a chunk of n stacks of stack_bytes each.  Makes only system calls, so
+// that the arena lock need not be held.
+static struct stack_chunk *stack_chunk_map(size_t stack_bytes, size_t n) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    size_t slot = stack_bytes + page_size;
+    size_t length = n * slot + page_size;
+    char *base = (char *)mmap(0, length, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (MAP_FAILED == base)
+        cilkrts_bug(NULL, "Cilk: stack arena mmap failed");
+
+    if (!stack_chunk_guard_install(base, slot, n)) {
+        for (size_t i = 0; i <= n; ++i) {
+            if (mprotect(base + i * slot, page_size, PROT_NONE) < 0)
+                cilkrts_bug(NULL, "Cilk: stack arena mprotect failed");
+        }
+    }
+
+    struct stack_chunk *chunk =
+        (struct stack_chunk *)malloc(sizeof(struct stack_chunk));
+    chunk->base = base;
+    chunk->length = length;
+    chunk->nstacks = n;
+    return chunk;
+}
+
+// Add the stacks of chunk to the arena.  The caller holds the arena lock.
+static void stack_arena_add(struct stack_arena *a, struct stack_chunk *chunk) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    size_t slot = a->stack_bytes + page_size;
+    size_t n = chunk->nstacks;
+
+    // Every stack of the arena may be on the free list at once.
+    if (a->nstacks + n > a->free_cap) {
+        a->free_cap = a->nstacks + n;
+        a->free = (char **)realloc(a->free, a->free_cap * sizeof(char *));
+    }
+    // Hand out the lowest stacks first.
+    for (size_t i = n; i-- > 0;)
+        a->free[a->nfree++] = chunk->base + page_size + i * slot;
+
+    chunk->next = a->chunks;
+    a->chunks = chunk;
+    a->nstacks += n;
+}
+
+static void arena_take_stack(struct cilk_fiber *f, struct stack_arena *a) {
+    const size_t page_size = 1U << cheetah_page_shift;
+
+    cilk_mutex_lock(&a->lock);
+    if (a->nfree == 0) {
+        size_t n = a->nstacks;
+        if (n < STACK_ARENA_MIN_CHUNK)
+            n = STACK_ARENA_MIN_CHUNK;
+        else if (n > STACK_ARENA_MAX_CHUNK)
+            n = STACK_ARENA_MAX_CHUNK;
+        // Other workers may grow the arena meanwhile, which only leaves
+        // more free stacks.
+        cilk_mutex_unlock(&a->lock);
+        struct stack_chunk *chunk = stack_chunk_map(a->stack_bytes, n);
+        cilk_mutex_lock(&a->lock);
+        stack_arena_add(a, chunk);
+    }
+    char *stack_low = a->free[--a->nfree];
+    cilk_mutex_unlock(&a->lock);
+
+    f->alloc_low = stack_low - page_size;
+    f->stack_low = stack_low;
+    f->stack_high = stack_low + a->stack_bytes;
+    f->alloc_high = f->stack_high + page_size;
+    f->resident = 0;
+    f->arena = a;
+    if (DEBUG_ENABLED(MEMORY_SLOW)) {
+        memset(stack_low, 0x11, a->stack_bytes);
+        f->resident = a->stack_bytes;
+    }
+}
+
+static void arena_give_stack(struct cilk_fiber *f) {
+    struct stack_arena *a = f->arena;
+    madvise(f->stack_low, a->stack_bytes, MADV_DONTNEED);
+    cilk_mutex_lock(&a->lock);
+    a->free[a->nfree++] = f->stack_low;
+    cilk_mutex_unlock(&a->lock);
+}
+
+void cilk_stack_arena_init(struct stack_arena *a, size_t stack_size) {
+    cilk_mutex_init(&a->lock);
+    a->stack_bytes = stack_bytes_for(stack_size);
+    a->chunks = NULL;
+    a->free = NULL;
+    a->nfree = 0;
+    a->free_cap = 0;
+    a->nstacks = 0;
+}
+
+void cilk_stack_arena_destroy(struct stack_arena *a) {
+    while (a->chunks) {
+        struct stack_chunk *chunk = a->chunks;
+        a->chunks = chunk->next;
+        if (munmap(chunk->base, chunk->length) < 0)
+            cilkrts_bug(NULL, "Cilk: stack arena munmap failed");
+        free(chunk);
+    }
+    free(a->free);
+    a->free = NULL;
+    a->nfree = a->free_cap = 0;
+    a->nstacks = 0;
+    cilk_mutex_destroy(&a->lock);
 }
 
 static void free_stack(struct cilk_fiber *f) {
     if (f->alloc_low) {
         if (DEBUG_ENABLED(MEMORY_SLOW))
             memset(f->stack_low, 0xbb, f->stack_high - f->stack_low);
-        if (munmap(f->alloc_low, f->alloc_high - f->alloc_low) < 0)
+        if (f->arena)
+            arena_give_stack(f);
+        else if (munmap(f->alloc_low, f->alloc_high - f->alloc_low) < 0)
             cilkrts_bug(NULL, "Cilk: stack munmap failed");
         f->alloc_low = NULL;
         f->stack_low = NULL;
         f->stack_high = NULL;
         f->alloc_high = NULL;
+        f->resident = 0;
+        f->arena = NULL;
     }
 }
 
@@ -102,6 +303,8 @@ static void fiber_init(struct cilk_fiber *fiber) {
     fiber->stack_low = NULL;
     fiber->stack_high = NULL;
     fiber->alloc_high = NULL;
+    fiber->resident = 0;
+    fiber->arena = NULL;
     fiber->owner = NULL;
 }
 
@@ -148,7 +351,12 @@ struct cilk_fiber *cilk_fiber_allocate(__cilkrts_worker *w, size_t stacksize) {
     struct cilk_fiber *fiber =
         cilk_internal_malloc(w, sizeof(*fiber), IM_FIBER);
     fiber_init(fiber);
-    make_stack(fiber, stacksize);
+    struct stack_arena *arena = &w->g->stack_arena;
+    if (w->g->options.stack_arena &&
+        stack_bytes_for(stacksize) == arena->stack_bytes)
+        arena_take_stack(fiber, arena);
+    else
+        make_stack(fiber, stacksize);
     cilkrts_alert(FIBER, w, "Allocate fiber %p [%p--%p]", (void *)fiber,
                   (void *)fiber->stack_low, (void *)fiber->stack_high);
     return fiber;
@@ -193,3 +401,70 @@ int in_fiber(struct cilk_fiber *fiber, void *p) {
     void *low = fiber->stack_low, *high = fiber->stack_high;
     return p >= low && p < high;
 }
+
+size_t cilk_fiber_resident(struct cilk_fiber *fiber) {
+    return fiber->resident;
+}
+
+// Count the resident bytes of [low, high), which must be whole pages.  If the
+// kernel cannot tell, count all of them.
+static size_t resident_bytes(char *low, char *high) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    unsigned char vec[256]; // void * converts to mincore's char * on BSD
+    size_t bytes = 0;
+    while (low < high) {
+        size_t n = (size_t)(high - low) >> cheetah_page_shift;
+        if (n > sizeof vec)
+            n = sizeof vec;
+        if (mincore(low, n << cheetah_page_shift, (void *)vec) != 0)
+            return bytes + (size_t)(high - low);
+        for (size_t i = 0; i < n; ++i)
+            if (vec[i] & 1)
+                bytes += page_size;
+        low += n << cheetah_page_shift;
+    }
+    return bytes;
+}
+
+void cilk_fiber_release_stack(struct cilk_fiber *fiber, size_t reserve) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    size_t size = fiber->stack_high - fiber->stack_low;
+    char *kept = fiber->stack_low; // lowest byte that may still be resident
+    // The landingpad of a Cilk function returns the fiber it unwound on to
+    // the pool before it leaves that fiber.
+    if (reserve < size && !in_fiber(fiber, __builtin_frame_address(0))) {
+        // Keep whole pages at the top, where the next use will start.
+        reserve = (reserve + page_size - 1) & ~(page_size - 1);
+        if (reserve < size &&
+            madvise(fiber->stack_low, size - reserve, STACK_RELEASE_ADVICE) == 0)
+            kept = fiber->stack_high - reserve;
+    }
+    // Only the pool summary reads the count, so the system call to measure
+    // it is made only when the summary is printed.
+    if (ALERT_ENABLED(FIBER_SUMMARY))
+        fiber->resident = resident_bytes(kept, fiber->stack_high);
+    else
+        fiber->resident = fiber->stack_high - kept;
+}
+
+// MAP_POPULATE only applies to whole mappings, and an arena stack is part of
+// a larger one, so the top of the stack is populated with madvise where the
+// kernel supports it, and by writing to each page otherwise.
+void cilk_fiber_prefault_stack(struct cilk_fiber *fiber, size_t bytes) {
+    const size_t page_size = 1U << cheetah_page_shift;
+    size_t size = fiber->stack_high - fiber->stack_low;
+    bytes = (bytes + page_size - 1) & ~(page_size - 1);
+    if (bytes > size)
+        bytes = size;
+    if (bytes <= fiber->resident)
+        return;
+    char *low = fiber->stack_high - bytes;
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(low, bytes, MADV_POPULATE_WRITE) != 0)
+#endif
+    {
+        for (volatile char *p = low; p < fiber->stack_high; p += page_size)
+            *p = 0;
+    }
+    fiber->resident = bytes;
+}
@@ -6,6 +6,7 @@
 #include "rts-config.h"
 #include "types.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 
 //===============================================================
@@ -17,11 +18,27 @@ struct fiber_pool_stats {
     int in_use;     // number of fibers allocated - freed from / into the pool
     int max_in_use; // high watermark for in_use
     unsigned max_free; // high watermark for number of free fibers in the pool
+    size_t resident;     // bytes of the pool's free stacks that may be resident
+    size_t max_resident; // high watermark for resident
+};
+
+// The shared pool is lock-free.  Its fibers array has a fixed capacity, and
+// its slots are linked into two Treiber stacks: the slots holding a fiber and
+// the empty ones.  A stack head packs the index of the top slot in its low 32
+// bits with a tag that every update increments, so that a thief working from
+// a stale head fails its compare-and-swap instead of corrupting the stack.
+// The shared pool's size and stats are kept here while workers run.
+struct fiber_slots {
+    _Atomic uint64_t full;  // slots holding a free fiber
+    _Atomic uint64_t empty; // slots without one
+    _Atomic uint32_t *next; // the slot below each slot in its stack
+    atomic_long size, max_free;
+    atomic_long in_use, max_in_use;
+    atomic_long resident, max_resident;
 };
 
 struct cilk_fiber_pool {
-    cilk_mutex lock;
-    worker_id mutex_owner;
+    struct fiber_slots slots; // used by the shared pool only
     int shared;
     size_t stack_size;              // Size of stacks for fibers in this pool.
     struct cilk_fiber_pool *parent; // Parent pool.
@@ -31,10 +48,25 @@ struct cilk_fiber_pool {
     unsigned int capacity;      // Limit on number of fibers in pool
     unsigned int size;          // Number of fibers currently in the pool
     struct fiber_pool_stats stats;
+    // What a private pool saw since it was last resized; see
+    // cilk_fiber_pool_per_worker_adapt
+    unsigned int refills, spills; // batches taken from / given to parent
+    unsigned int low, high;       // watermarks of size
+    unsigned int quiet_regions;   // regions in a row with neither
 };
 
 struct cilk_fiber; // opaque type
 
+// Fiber stacks carved out of large mappings; see fiber.c.
+struct stack_arena {
+    cilk_mutex lock;
+    size_t stack_bytes;         // usable bytes of each stack
+    struct stack_chunk *chunks; // the mappings
+    char **free;                // lowest usable byte of each free stack
+    size_t nfree, free_cap;
+    size_t nstacks;             // stacks in all chunks
+};
+
 //===============================================================
 // Supported functions
 //===============================================================
@@ -83,10 +115,17 @@ char *sysdep_reset_stack_for_resume(struct cilk_fiber *fiber,
 CHEETAH_INTERNAL_NORETURN
 void sysdep_longjmp_to_sf(__cilkrts_stack_frame *sf);
 
+CHEETAH_INTERNAL void cilk_stack_arena_init(struct stack_arena *a,
+                                            size_t stack_size);
+// Unmaps every stack of the arena.
+CHEETAH_INTERNAL void cilk_stack_arena_destroy(struct stack_arena *a);
+
 CHEETAH_INTERNAL void cilk_fiber_pool_global_init(global_state *g);
 CHEETAH_INTERNAL void cilk_fiber_pool_global_terminate(global_state *g);
 CHEETAH_INTERNAL void cilk_fiber_pool_global_destroy(global_state *g);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_init(__cilkrts_worker *w);
+CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_prewarm(__cilkrts_worker *w);
+CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_adapt(__cilkrts_worker *w);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_terminate(__cilkrts_worker *w);
 CHEETAH_INTERNAL void cilk_fiber_pool_per_worker_destroy(__cilkrts_worker *w);
 
@@ -111,4 +150,15 @@ void cilk_fiber_deallocate_to_pool(__cilkrts_worker *w,
 
 CHEETAH_INTERNAL int in_fiber(struct cilk_fiber *, void *);
 
+// The bytes of fiber's stack that were resident when it last entered a pool.
+CHEETAH_INTERNAL size_t cilk_fiber_resident(struct cilk_fiber *fiber);
+// Let the OS reclaim the pages of fiber's stack below the top reserve bytes,
+// and measure how much of the stack is left resident.  The fiber must not be
+// in use.
+CHEETAH_INTERNAL void cilk_fiber_release_stack(struct cilk_fiber *fiber,
+                                               size_t reserve);
+// Fault in the top bytes of fiber's stack, on the calling thread's NUMA node.
+CHEETAH_INTERNAL void cilk_fiber_prefault_stack(struct cilk_fiber *fiber,
+                                                size_t bytes);
+
 #endif
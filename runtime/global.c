@@ -39,6 +39,7 @@ static global_state *global_state_allocate() {
 
     cilk_mutex_init(&g->im_lock);
     cilk_mutex_init(&g->print_lock);
+    cilk_mutex_init(&g->counters_lock);
 
     // TODO: Convert to cilk_* equivalents
     pthread_mutex_init(&g->cilkified_lock, NULL);
@@ -74,6 +75,67 @@ static void set_fiber_pool_cap(global_state *g, unsigned int fiber_pool_cap) {
     g->options.fiber_pool_cap = fiber_pool_cap;
 }
 
+static void set_handoff_spin(global_state *g, unsigned int handoff_spin) {
+    CILK_ASSERT_G(!g->workers_started);
+    CILK_ASSERT_G(handoff_spin <= 1000000);
+    g->options.handoff_spin = handoff_spin;
+}
+
+static void set_max_roots(global_state *g, unsigned int max_roots) {
+    CILK_ASSERT_G(!g->workers_started);
+    CILK_ASSERT_G(max_roots <= 99999);
+    g->options.max_roots = max_roots;
+}
+
+static void set_steal_batch(global_state *g, unsigned int steal_batch) {
+    CILK_ASSERT_G(!g->workers_started);
+    CILK_ASSERT_G(steal_batch >= 1);
+    CILK_ASSERT_G(steal_batch <= 64);
+    g->options.steal_batch = steal_batch;
+}
+
+static void set_steal_policy(global_state *g, const char *name) {
+    CILK_ASSERT_G(!g->workers_started);
+    if (!strcmp(name, "uniform"))
+        g->options.steal_policy = STEAL_POLICY_UNIFORM;
+    else if (!strcmp(name, "last-victim"))
+        g->options.steal_policy = STEAL_POLICY_LAST_VICTIM;
+    else if (!strcmp(name, "power-of-two"))
+        g->options.steal_policy = STEAL_POLICY_POWER_OF_TWO;
+    else
+        fprintf(stderr,
+                "WARNING: unknown CILK_STEAL_POLICY %s. Using uniform.\n",
+                name);
+}
+
+static void set_steal_pct(global_state *g, unsigned int core,
+                          unsigned int cache, unsigned int socket) {
+    CILK_ASSERT_G(!g->workers_started);
+    // Check each term so that a huge value cannot wrap the sum.
+    if (core > 100 || cache > 100 || socket > 100 ||
+        core + cache + socket > 100) {
+        fprintf(stderr,
+                "WARNING: CILK_STEAL_CORE_PCT, CILK_STEAL_CACHE_PCT and "
+                "CILK_STEAL_SOCKET_PCT add up to more than 100. Using "
+                "%u, %u and %u.\n",
+                g->options.steal_core_pct, g->options.steal_cache_pct,
+                g->options.steal_socket_pct);
+        return;
+    }
+    g->options.steal_core_pct = core;
+    g->options.steal_cache_pct = cache;
+    g->options.steal_socket_pct = socket;
+}
+
+// Read a percentage from the environment.  Unlike env_get_int, an explicit 0
+// is distinguished from an unset variable.
+static unsigned int env_get_pct(char const *var, unsigned int dflt) {
+    const char *envstr = getenv(var);
+    if (envstr)
+        return strtoul(envstr, NULL, 0);
+    return dflt;
+}
+
 // not marked as static as it's called by __cilkrts_internal_set_nworkers
 // used by Cilksan to set nworker to 1 
 void set_nworkers(global_state *g, unsigned int nworkers) {
@@ -101,21 +163,52 @@ static void parse_rts_environment(global_state *g, unsigned int nworkers) {
     unsigned int fiber_pool_cap = env_get_int("CILK_FIBER_POOL");
     if (fiber_pool_cap > 0)
         set_fiber_pool_cap(g, fiber_pool_cap);
+    if (env_get_int("CILK_BOSS_WORKER"))
+        g->options.boss_worker = 1;
+    unsigned int handoff_spin = env_get_int("CILK_HANDOFF_SPIN");
+    if (handoff_spin > 0)
+        set_handoff_spin(g, handoff_spin);
+    unsigned int max_roots = env_get_int("CILK_MAX_ROOTS");
+    if (max_roots > 0)
+        set_max_roots(g, max_roots);
+    unsigned int steal_batch = env_get_int("CILK_STEAL_BATCH");
+    if (steal_batch > 0)
+        set_steal_batch(g, steal_batch);
+    const char *steal_policy = getenv("CILK_STEAL_POLICY");
+    if (steal_policy)
+        set_steal_policy(g, steal_policy);
+    const char *serial = getenv("CILK_SERIAL");
+    if (serial)
+        g->options.serial = strtol(serial, NULL, 0) != 0;
+    if (env_get_int("CILK_LEAPFROG"))
+        g->options.leapfrog = 1;
+    const char *stack_reserve = getenv("CILK_STACK_RESERVE");
+    if (stack_reserve)
+        g->options.stack_reserve = strtoul(stack_reserve, NULL, 0);
+    const char *stack_arena = getenv("CILK_STACK_ARENA");
+    if (stack_arena)
+        g->options.stack_arena = strtol(stack_arena, NULL, 0) != 0;
+    g->options.fiber_prewarm = env_get_int("CILK_FIBER_PREWARM");
+    g->options.fiber_prewarm_global = env_get_int("CILK_FIBER_PREWARM_GLOBAL");
+    const char *stack_prefault = getenv("CILK_STACK_PREFAULT");
+    if (stack_prefault)
+        g->options.stack_prefault = strtoul(stack_prefault, NULL, 0);
+    const char *fiber_pool_adapt = getenv("CILK_FIBER_POOL_ADAPT");
+    if (fiber_pool_adapt)
+        g->options.fiber_pool_adapt = strtol(fiber_pool_adapt, NULL, 0) != 0;
+
+    set_steal_pct(
+        g, env_get_pct("CILK_STEAL_CORE_PCT", g->options.steal_core_pct),
+        env_get_pct("CILK_STEAL_CACHE_PCT", g->options.steal_cache_pct),
+        env_get_pct("CILK_STEAL_SOCKET_PCT", g->options.steal_socket_pct));
 
     //long proc_override = env_get_int("CILK_NWORKERS");
     long proc_override = nworkers;
     if (g->options.nproc == 0) {
-        // use the number of cores online right now
+        // use the number of cores available to this runtime
         int available_cores = 0;
 #ifdef CPU_SETSIZE
-        cpu_set_t process_mask;
-        // get the mask from the parent thread (master thread)
-        int err = pthread_getaffinity_np(pthread_self(), sizeof(process_mask),
-                                         &process_mask);
-        if (0 == err) {
-            // Get the number of available cores (copied from os-unix.c)
-            available_cores = CPU_COUNT(&process_mask);
-        }
+        available_cores = CPU_COUNT(&g->cpuset);
 #endif
         if (proc_override > 0)
             g->options.nproc = proc_override;
@@ -151,7 +244,24 @@ static void parse_rts_environment(global_state *g, unsigned int nworkers) {
     }
 }
 
-global_state *global_state_init(int argc, char *argv[]) {
+// Set the CPUs g's workers may run on: the cpuset in config, limited to CPUs
+// that exist, or the affinity of the calling thread if config is NULL or its
+// cpuset is empty.
+static void set_cpuset(global_state *g, const cilk_config_t *config) {
+    CPU_ZERO(&g->cpuset);
+    if (config) {
+        long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < ncpus && cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &config->boss_affinity))
+                CPU_SET(cpu, &g->cpuset);
+        }
+    }
+    if (CPU_COUNT(&g->cpuset) == 0)
+        pthread_getaffinity_np(pthread_self(), sizeof(g->cpuset), &g->cpuset);
+}
+
+global_state *global_state_init(const cilk_config_t *config,
+                                unsigned int max_roots) {
     cilkrts_alert(BOOT, NULL,
                   "(global_state_init) Initializing global state");
 
@@ -164,21 +274,66 @@ global_state *global_state_init(int argc, char *argv[]) {
 
     g->boss = pthread_self();
     g->options = (struct rts_options)DEFAULT_OPTIONS;
-    parse_rts_environment(g, argc);
+    set_cpuset(g, config);
+    parse_rts_environment(g, config ? config->n_workers : 0);
+    if (config && config->version == CILK_CONFIG_VERSION) {
+        // Settings in config take precedence over the environment.
+        if (config->fiber_prewarm)
+            g->options.fiber_prewarm = config->fiber_prewarm;
+        if (config->fiber_prewarm_global)
+            g->options.fiber_prewarm_global = config->fiber_prewarm_global;
+        if (config->stack_prefault)
+            g->options.stack_prefault = config->stack_prefault;
+    }
+    if (max_roots > 0)
+        set_max_roots(g, max_roots);
+    if (g->options.max_roots > 0 && g->options.boss_worker) {
+        // Cilkifying threads of a multi-root runtime come and go, so none
+        // of them can own a worker.
+        cilkrts_alert(BOOT, NULL, "(global_state_init) Disabling boss worker");
+        g->options.boss_worker = 0;
+    }
 
     unsigned active_size = g->options.nproc;
     CILK_ASSERT_G(active_size > 0);
     g->nworkers = active_size;
     cilkg_nproc = active_size;
 
+#ifdef CPU_SETSIZE
+    // Spinning between regions only pays when every thread that spins has a
+    // CPU of its own; otherwise it delays the thread being waited for.
+    if (g->options.handoff_spin > 0 &&
+        active_size + !g->options.boss_worker >
+            (unsigned)CPU_COUNT(&g->cpuset)) {
+        cilkrts_alert(BOOT, NULL, "(global_state_init) Disabling handoff spin");
+        g->options.handoff_spin = 0;
+    }
+#endif
+
     g->workers_started = false;
-    g->root_closure_initialized = false;
     atomic_store_explicit(&g->start, 0, memory_order_relaxed);
     atomic_store_explicit(&g->done, 0, memory_order_relaxed);
     atomic_store_explicit(&g->cilkified, 0, memory_order_relaxed);
     g->terminate = false;
     g->exiting_worker = 0;
     atomic_store_explicit(&g->reducer_map_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->prewarm_pending, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->park_seq, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->nparked, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->active_workers, active_size,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g->regions, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->lend_seq, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->nlent, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->start_sleepers, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->cilkified_sleeping, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->nready_roots, 0, memory_order_relaxed);
+    atomic_store_explicit(&g->loop, NULL, memory_order_relaxed);
+    atomic_store_explicit(&g->loop_helpers, 0, memory_order_relaxed);
+    for (int i = 0; i < CILK_IDLE_GROUPS; ++i)
+        atomic_store_explicit(&g->idle_groups[i].nidle, 0,
+                              memory_order_relaxed);
+    atomic_store_explicit(&g->hungry_groups, 0, memory_order_relaxed);
 
     g->workers =
         (__cilkrts_worker **)calloc(active_size, sizeof(__cilkrts_worker *));
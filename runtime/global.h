@@ -19,6 +19,17 @@
 struct __cilkrts_worker;
 struct reducer_id_manager;
 struct Closure;
+struct cilk_root;
+struct cilk_async;
+struct cilk_loop;
+
+// How a thief chooses the worker to steal from; see choose_victim.
+enum steal_policy {
+    STEAL_POLICY_UNIFORM = 0, // at random, weighted by topology if known
+    STEAL_POLICY_LAST_VICTIM, // the last successful victim while it has work
+    STEAL_POLICY_POWER_OF_TWO, // the fuller of two random victims
+    NUMBER_OF_STEAL_POLICIES  // must be the very last entry
+};
 
 // clang-format off
 #define DEFAULT_OPTIONS                                            \
@@ -26,9 +37,25 @@ struct Closure;
         DEFAULT_STACK_SIZE,     /* stack size to use for fiber */  \
         DEFAULT_NPROC,          /* num of workers to create */     \
         DEFAULT_REDUCER_LIMIT,  /* num of simultaneous reducers */ \
-        DEFAULT_DEQ_DEPTH,      /* num of entries in deque */      \
+        DEFAULT_DEQ_DEPTH,      /* initial entries in deque */     \
         DEFAULT_FIBER_POOL_CAP, /* alloc_batch_size */             \
         DEFAULT_FORCE_REDUCE,   /* whether to force self steal and reduce */\
+        DEFAULT_STEAL_CORE_PCT,   /* percent of steals within a core */    \
+        DEFAULT_STEAL_CACHE_PCT,  /* percent of steals within the LLC */   \
+        DEFAULT_STEAL_SOCKET_PCT, /* percent of steals within a socket */  \
+        DEFAULT_BOSS_WORKER,    /* whether the Cilkifying thread works */  \
+        DEFAULT_HANDOFF_SPIN,   /* usec to spin on start and cilkified */  \
+        DEFAULT_MAX_ROOTS,      /* concurrent Cilkified regions, if > 0 */ \
+        DEFAULT_STEAL_BATCH,    /* closures taken per successful steal */  \
+        DEFAULT_STEAL_POLICY,   /* how thieves choose victims */           \
+        DEFAULT_SERIAL,         /* whether one worker skips stealing */    \
+        DEFAULT_LEAPFROG,       /* steal from children after failed sync */\
+        DEFAULT_STACK_RESERVE,  /* bytes of pooled stacks kept resident */ \
+        DEFAULT_STACK_ARENA,    /* whether stacks come from an arena */    \
+        DEFAULT_FIBER_PREWARM,  /* fibers per worker made at startup */    \
+        DEFAULT_FIBER_PREWARM_GLOBAL, /* global pool fibers made then */   \
+        DEFAULT_STACK_PREFAULT, /* bytes of those stacks faulted in */     \
+        DEFAULT_FIBER_POOL_ADAPT, /* whether worker pools are resized */   \
     }
 // clang-format on
 
@@ -39,6 +66,22 @@ struct rts_options {
     unsigned int deqdepth;       /* can be set via env variable CILK_DEQDEPTH */
     unsigned int fiber_pool_cap; /* can be set via env variable CILK_FIBER_POOL */
     unsigned int force_reduce;   /* can be set via env variable CILK_FORCE_REDUCE */
+    unsigned int steal_core_pct;   /* can be set via env variable CILK_STEAL_CORE_PCT */
+    unsigned int steal_cache_pct;  /* can be set via env variable CILK_STEAL_CACHE_PCT */
+    unsigned int steal_socket_pct; /* can be set via env variable CILK_STEAL_SOCKET_PCT */
+    unsigned int boss_worker;    /* can be set via env variable CILK_BOSS_WORKER */
+    unsigned int handoff_spin;   /* can be set via env variable CILK_HANDOFF_SPIN */
+    unsigned int max_roots;      /* can be set via env variable CILK_MAX_ROOTS */
+    unsigned int steal_batch;    /* can be set via env variable CILK_STEAL_BATCH */
+    unsigned int steal_policy;   /* can be set via env variable CILK_STEAL_POLICY */
+    unsigned int serial;         /* can be set via env variable CILK_SERIAL */
+    unsigned int leapfrog;       /* can be set via env variable CILK_LEAPFROG */
+    size_t stack_reserve;        /* can be set via env variable CILK_STACK_RESERVE */
+    unsigned int stack_arena;    /* can be set via env variable CILK_STACK_ARENA */
+    unsigned int fiber_prewarm;  /* can be set via env variable CILK_FIBER_PREWARM */
+    unsigned int fiber_prewarm_global; /* can be set via env variable CILK_FIBER_PREWARM_GLOBAL */
+    size_t stack_prefault;       /* can be set via env variable CILK_STACK_PREFAULT */
+    unsigned int fiber_pool_adapt; /* can be set via env variable CILK_FIBER_POOL_ADAPT */
 };
 
 struct global_state {
@@ -50,21 +93,58 @@ struct global_state {
     /* dynamically-allocated array of deques, one per processor */
     struct ReadyDeque *deques;
     pthread_t *threads;
-    struct Closure *root_closure;
+    struct Closure *root_closure; /* closure of roots[0] */
+    cpu_set_t cpuset; /* CPUs this runtime's workers may run on */
 
     struct cilk_fiber_pool fiber_pool __attribute__((aligned(CILK_CACHE_LINE)));
+    struct stack_arena stack_arena __attribute__((aligned(CILK_CACHE_LINE)));
     struct global_im_pool im_pool __attribute__((aligned(CILK_CACHE_LINE)));
     struct cilk_im_desc im_desc __attribute__((aligned(CILK_CACHE_LINE)));
     cilk_mutex im_lock; // lock for accessing global im_desc
 
     volatile bool workers_started;
-    volatile bool root_closure_initialized;
     volatile atomic_bool start;
     volatile atomic_bool done;
     volatile atomic_bool cilkified;
     volatile bool terminate;
     volatile worker_id exiting_worker;
     volatile atomic_uint reducer_map_count;
+    // Workers still filling their fiber pools as they start; see
+    // prewarm_workers in init.c
+    atomic_uint prewarm_pending;
+
+    // Parking of idle workers; see park.c
+    atomic_uint park_seq __attribute__((aligned(CILK_CACHE_LINE)));
+    atomic_uint nparked;
+    // Workers [active_workers, nworkers) are lent out; see arbiter.c
+    atomic_uint active_workers;
+    atomic_ulong regions; // Cilkified regions started, for the arbiter
+    atomic_uint lend_seq;
+    atomic_uint nlent;
+
+    // Roots of Cilkified regions, options.max_roots of them or one; see
+    // roots.c
+    struct cilk_root *roots;
+    struct cilk_root *free_roots;
+    struct cilk_root *ready_roots, *ready_roots_tail;
+    pthread_mutex_t roots_lock;
+    pthread_cond_t roots_cond_var; // signaled when a root is released
+    atomic_uint nready_roots __attribute__((aligned(CILK_CACHE_LINE)));
+    // The loop of __cilkrts_static_for that idle workers help with; see
+    // loop.c
+    _Atomic(struct cilk_loop *) loop;
+    atomic_uint loop_helpers;
+
+    // Idle thieves, counted per socket, and the number of sockets with any;
+    // see worker_set_hungry in park.h
+    struct {
+        atomic_int nidle __attribute__((aligned(CILK_CACHE_LINE)));
+    } idle_groups[CILK_IDLE_GROUPS];
+    atomic_int hungry_groups __attribute__((aligned(CILK_CACHE_LINE)));
+
+    // Threads running regions submitted by cilk_thrd_async, created on first
+    // use; see async.c
+    struct cilk_async *async;
 
     cilk_mutex print_lock; // global lock for printing messages
 
@@ -72,10 +152,17 @@ struct global_state {
     pthread_cond_t cilkified_cond_var;
     pthread_mutex_t start_lock;
     pthread_cond_t start_cond_var;
+    // Threads blocked, or about to block, on the condition variables above.
+    // The signaling side skips the lock and the syscall when there are none.
+    atomic_uint start_sleepers;
+    atomic_bool cilkified_sleeping;
 
     struct reducer_id_manager *id_manager; /* null while Cilk is running */
 
     struct global_sched_stats stats;
+    // Totals of the workers' counters last returned by cilk_thrd_take_stats
+    uint64_t counters_taken[NUMBER_OF_COUNTERS];
+    cilk_mutex counters_lock;
 
     pthread_t boss;
 };
@@ -86,7 +173,8 @@ extern __thread global_state *my_cilkrts;
 CHEETAH_INTERNAL void set_nworkers(global_state *g, unsigned int nworkers);
 CHEETAH_INTERNAL void set_force_reduce(global_state *g,
                                        unsigned int force_reduce);
-CHEETAH_INTERNAL global_state *global_state_init(int argc, char *argv[]);
+CHEETAH_INTERNAL global_state *global_state_init(const cilk_config_t *config,
+                                                unsigned int max_roots);
 CHEETAH_INTERNAL void for_each_worker(global_state *,
                                       void (*)(__cilkrts_worker *, void *),
                                       void *data);
@@ -19,14 +19,19 @@
 #endif
 #include <unistd.h>
 
+#include "arbiter.h"
+#include "async.h"
 #include "debug.h"
 #include "fiber.h"
 #include "global.h"
 #include "init.h"
 #include "local.h"
+#include "park.h"
 #include "readydeque.h"
+#include "roots.h"
 #include "sched_stats.h"
 #include "scheduler.h"
+#include "topology.h"
 
 #include "reducer_impl.h"
 
@@ -37,29 +42,66 @@ extern void cleanup_invoke_main(Closure *invoke_main);
 typedef cpuset_t cpu_set_t;
 #endif
 
-static local_state *worker_local_init(global_state *g) {
-    local_state *l = (local_state *)calloc(1, sizeof(local_state));
-    l->shadow_stack = (__cilkrts_stack_frame **)calloc(
-        g->options.deqdepth, sizeof(struct __cilkrts_stack_frame *));
+static void worker_local_init(global_state *g, local_state *l) {
+    memset(l, 0, sizeof(local_state));
+    l->shadow_stack = shadow_stack_alloc(g->options.deqdepth);
     for (int i = 0; i < JMPBUF_SIZE; i++) {
         l->rts_ctx[i] = NULL;
     }
     l->fiber_to_free = NULL;
+    l->finished_root = NULL;
     l->state = WORKER_IDLE;
     l->lock_wait = false;
     l->provably_good_steal = false;
     l->rand_next = 0; /* will be reset in scheduler loop */
+    l->last_victim = NO_WORKER;
     cilk_sched_stats_init(&(l->stats));
+}
+
+// A worker and its local state share one allocation of whole pages, which
+// no other data shares, so that the worker's thread can move the pages to
+// its own NUMA node.  The local state starts on a cache line of its own.
+static inline size_t worker_local_offset(void) {
+    size_t align = __alignof__(local_state) > CILK_CACHE_LINE
+                       ? __alignof__(local_state)
+                       : CILK_CACHE_LINE;
+    return (sizeof(__cilkrts_worker) + align - 1) & ~(align - 1);
+}
+
+static inline size_t worker_alloc_size(void) {
+    size_t page_size = (size_t)1 << cheetah_page_shift;
+    size_t size = worker_local_offset() + sizeof(local_state);
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+static __cilkrts_worker *worker_alloc(void) {
+    size_t page_size = (size_t)1 << cheetah_page_shift;
+    __cilkrts_worker *w = (__cilkrts_worker *)cilk_aligned_alloc(
+        page_size, worker_alloc_size());
+    memset(w, 0, sizeof(__cilkrts_worker));
+    w->l = (local_state *)((char *)w + worker_local_offset());
+    return w;
+}
 
-    return l;
+// Workers are initialized by the thread that starts the runtime, so their
+// pages are first touched on that thread's NUMA node.  Move the pages of w,
+// its local state and its shadow stack to the node of the CPU that the
+// calling thread, w's own, runs on.
+static void worker_move_home(__cilkrts_worker *w) {
+    topology_move_home(w, worker_alloc_size());
+    topology_move_home(w->l->shadow_stack,
+                       shadow_stack_bytes(w->ltq_limit - w->l->shadow_stack));
 }
 
 static void deques_init(global_state *g) {
     cilkrts_alert(BOOT, NULL, "(deques_init) Initializing deques");
     for (unsigned int i = 0; i < g->options.nproc; i++) {
-        g->deques[i].top = NULL;
-        g->deques[i].bottom = NULL;
+        atomic_store_explicit(&g->deques[i].top, NULL, memory_order_relaxed);
+        atomic_store_explicit(&g->deques[i].bottom, NULL, memory_order_relaxed);
         g->deques[i].mutex_owner = NO_WORKER;
+        g->deques[i].stash_top = NULL;
+        g->deques[i].stash_bottom = NULL;
+        atomic_store_explicit(&g->deques[i].nstash, 0, memory_order_relaxed);
         cilk_mutex_init(&(g->deques[i].mutex));
     }
 }
@@ -68,11 +110,10 @@ static void workers_init(global_state *g) {
     cilkrts_alert(BOOT, NULL, "(workers_init) Initializing workers");
     for (unsigned int i = 0; i < g->options.nproc; i++) {
         cilkrts_alert(BOOT, NULL, "(workers_init) Initializing worker %u", i);
-        __cilkrts_worker *w = (__cilkrts_worker *)cilk_aligned_alloc(
-            __alignof__(__cilkrts_worker), sizeof(__cilkrts_worker));
+        __cilkrts_worker *w = worker_alloc();
         w->self = i;
         w->g = g;
-        w->l = worker_local_init(g);
+        worker_local_init(g, w->l);
 
         w->ltq_limit = w->l->shadow_stack + g->options.deqdepth;
         g->workers[i] = w;
@@ -88,22 +129,95 @@ static void workers_init(global_state *g) {
     }
 }
 
+// With the boss_worker option, the Cilkifying thread runs as this worker
+// during a Cilkified region, and no Pthread is created for it.
+#define BOSS_WORKER 0
+
+static inline bool is_boss_worker(global_state *g, worker_id self) {
+    return g->options.boss_worker && self == BOSS_WORKER;
+}
+
+// Wait for g->start == 1, spinning for a while after the previous Cilkified
+// region before blocking on start_cond_var.
+static void wait_for_start(__cilkrts_worker *w) {
+    global_state *g = w->g;
+    // A worker that is lent out would spin on a CPU that is not ours.
+    if (!worker_is_lent(w) &&
+        spin_on_flag(&g->start, true, g->options.handoff_spin))
+        return;
+
+    // Count this worker as a sleeper before checking g->start, so that
+    // either invoke_cilkified_root sees the sleeper or we see the start.
+    pthread_mutex_lock(&g->start_lock);
+    atomic_fetch_add_explicit(&g->start_sleepers, 1, memory_order_seq_cst);
+    while (!atomic_load_explicit(&g->start, memory_order_seq_cst)) {
+        pthread_cond_wait(&g->start_cond_var, &g->start_lock);
+    }
+    atomic_fetch_sub_explicit(&g->start_sleepers, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&g->start_lock);
+}
+
+// Run the work-stealing loop of w for one Cilkified region.
+static void worker_run_region(__cilkrts_worker *w) {
+    worker_id self = w->self;
+
+    if (w->g->options.max_roots) {
+        // Workers of a multi-root runtime stay in the work-stealing loop
+        // until the runtime shuts down, and take roots from its ready queue.
+        worker_scheduler(w, NULL);
+        return;
+    }
+
+    // Start the new Cilkified region using the last worker that finished a
+    // Cilkified region.  This approach ensures that the new Cilkified
+    // region starts on an available worker with the worker state that was
+    // updated by any operations that occurred outside of Cilkified regions.
+    // Such operations, for example might have updated the left-most view of
+    // a reducer.
+    if (self == w->g->exiting_worker) {
+        worker_scheduler(w, w->g->root_closure);
+    } else {
+        worker_scheduler(w, NULL);
+    }
+
+    // At this point, some worker will have finished the Cilkified region,
+    // meaning it recordied its ID in g->exiting_worker and set g->done = 1.
+    // That worker's state accurately reflects the execution of the
+    // Cilkified region, including all updates to reducers.  Wait for that
+    // worker to exit the work-stealing loop, and use it to wake-up the
+    // original Cilkifying thread.
+    if (self == w->g->exiting_worker) {
+        // Mark the computation as no longer cilkified, to signal the thread
+        // that originally cilkified the execution.  Only take the lock if
+        // that thread stopped spinning and went to sleep.
+        global_state *g = w->g;
+        atomic_store_explicit(&g->cilkified, 0, memory_order_seq_cst);
+        if (atomic_load_explicit(&g->cilkified_sleeping,
+                                 memory_order_seq_cst)) {
+            pthread_mutex_lock(&(g->cilkified_lock));
+            pthread_cond_signal(&g->cilkified_cond_var);
+            pthread_mutex_unlock(&(g->cilkified_lock));
+        }
+    }
+
+    // Between regions, fit w's fiber pool to the region that just ended.
+    cilk_fiber_pool_per_worker_adapt(w);
+}
+
 static void *scheduler_thread_proc(void *arg) {
     __cilkrts_worker *w = (__cilkrts_worker *)arg;
     cilkrts_alert(BOOT, w, "scheduler_thread_proc");
     __cilkrts_set_tls_worker(w);
-
-    worker_id self = w->self;
+    worker_move_home(w);
+    if (atomic_load_explicit(&w->g->prewarm_pending, memory_order_acquire)) {
+        cilk_fiber_pool_per_worker_prewarm(w);
+        atomic_fetch_sub_explicit(&w->g->prewarm_pending, 1,
+                                  memory_order_release);
+    }
 
     do {
-        // Wait for g->start == 1 to start executing the work-stealing loop.  We
-        // use a condition variable to wait on g->start, because this approach
-        // seems to result in better performance.
-        pthread_mutex_lock(&w->g->start_lock);
-        while (!atomic_load_explicit(&w->g->start, memory_order_acquire)) {
-            pthread_cond_wait(&w->g->start_cond_var, &w->g->start_lock);
-        }
-        pthread_mutex_unlock(&w->g->start_lock);
+        // Wait for g->start == 1 to start executing the work-stealing loop.
+        wait_for_start(w);
 
         // Check if we should exit this scheduling function.
         if (w->g->terminate) {
@@ -113,33 +227,7 @@ static void *scheduler_thread_proc(void *arg) {
         /* TODO: Maybe import reducers here?  They must be imported
            before user code runs. */
 
-        // Start the new Cilkified region using the last worker that finished a
-        // Cilkified region.  This approach ensures that the new Cilkified
-        // region starts on an available worker with the worker state that was
-        // updated by any operations that occurred outside of Cilkified regions.
-        // Such operations, for example might have updated the left-most view of
-        // a reducer.
-        if (self == w->g->exiting_worker) {
-            worker_scheduler(w, w->g->root_closure);
-        } else {
-            worker_scheduler(w, NULL);
-        }
-
-        // At this point, some worker will have finished the Cilkified region,
-        // meaning it recordied its ID in g->exiting_worker and set g->done = 1.
-        // That worker's state accurately reflects the execution of the
-        // Cilkified region, including all updates to reducers.  Wait for that
-        // worker to exit the work-stealing loop, and use it to wake-up the
-        // original Cilkifying thread.
-        if (self == w->g->exiting_worker) {
-            // Mark the computation as no longer cilkified, to signal the thread
-            // that originally cilkified the execution.
-            pthread_mutex_lock(&(w->g->cilkified_lock));
-            atomic_store_explicit(&w->g->cilkified, 0, memory_order_release);
-            pthread_cond_signal(&w->g->cilkified_cond_var);
-            pthread_mutex_unlock(&(w->g->cilkified_lock));
-        }
-
+        worker_run_region(w);
     } while (true);
 }
 
@@ -157,14 +245,13 @@ static void threads_init(global_state *g) {
        to request that two threads run as far apart as possible by
        giving them distinct "affinity tags". */
 #ifdef CPU_SETSIZE
-    // Affinity setting, from cilkplus-rts
-    cpu_set_t process_mask;
-    int available_cores = 0;
-    // Get the mask from the parent thread (master thread)
-    if (0 == pthread_getaffinity_np(pthread_self(), sizeof(process_mask),
-                                    &process_mask)) {
-        available_cores = CPU_COUNT(&process_mask);
-    }
+    // Affinity setting, from cilkplus-rts.  Workers are placed within the
+    // cpuset of this runtime, so that runtimes configured with disjoint
+    // cpusets do not share cores.
+    cpu_set_t process_mask = g->cpuset;
+    int available_cores = CPU_COUNT(&process_mask);
+    // Whether to bind workers at all, to a CPU group or to the whole cpuset.
+    bool bind_workers = true;
 
     /* pin_strategy controls how threads are spread over cpu numbers.
        Based on very limited testing FreeBSD groups hyperthreads of a
@@ -190,12 +277,18 @@ static void threads_init(global_state *g) {
         break;
     case 3:
         available_cores = 0;
+        bind_workers = false;
         break;
     }
 #endif
     int n_threads = g->nworkers;
     CILK_ASSERT_G(n_threads > 0);
 
+    // The first CPU each worker is bound to, for topology_init.
+    int *worker_cpus = (int *)malloc(n_threads * sizeof(int));
+    for (int w = 0; w < n_threads; w++)
+        worker_cpus[w] = -1;
+
     /* TODO: Apple supports thread affinity using a different interface. */
 
     cilkrts_alert(BOOT, NULL, "(threads_init) Setting up threads");
@@ -225,14 +318,15 @@ static void threads_init(global_state *g) {
 #endif
 
     for (int w = 0; w < n_threads; w++) {
-        int status = pthread_create(&g->threads[w], NULL, scheduler_thread_proc,
-                                    g->workers[w]);
-
-        if (status != 0)
-            cilkrts_bug(NULL, "Cilk: thread creation (%u) failed: %s", w,
-                        strerror(status));
+        // The boss worker keeps its share of the CPUs, but the Cilkifying
+        // thread is not ours to bind.
+        bool boss = is_boss_worker(g, w);
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
 
 #ifdef CPU_SETSIZE
+        // Bind the thread as it is created, so that it first runs, and
+        // moves its worker's pages, where it will stay.
         if (available_cores > 0) {
             /* Skip to the next active CPU ID.  */
             while (!CPU_ISSET(cpu, &process_mask)) {
@@ -241,6 +335,8 @@ static void threads_init(global_state *g) {
 
             cilkrts_alert(BOOT, NULL, "Bind worker %u to core %d of %d", w, cpu,
                           available_cores);
+            if (!boss)
+                worker_cpus[w] = cpu;
 
             CPU_CLR(cpu, &process_mask);
             cpu_set_t worker_mask;
@@ -254,18 +350,68 @@ static void threads_init(global_state *g) {
             }
             cpu += step_out;
 
-            int err = pthread_setaffinity_np(g->threads[w], sizeof(worker_mask),
-                                             &worker_mask);
+            if (!boss) {
+                int err = pthread_attr_setaffinity_np(
+                    &attr, sizeof(worker_mask), &worker_mask);
+                CILK_ASSERT_G(err == 0);
+            }
+        } else if (bind_workers && !boss) {
+            // Too many workers to give each its own CPUs; keep them all
+            // within the runtime's cpuset.
+            int err = pthread_attr_setaffinity_np(&attr, sizeof(g->cpuset),
+                                                  &g->cpuset);
             CILK_ASSERT_G(err == 0);
         }
 #endif
+
+        if (!boss) {
+            int status = pthread_create(&g->threads[w], &attr,
+                                        scheduler_thread_proc, g->workers[w]);
+
+            if (status != 0)
+                cilkrts_bug(NULL, "Cilk: thread creation (%u) failed: %s", w,
+                            strerror(status));
+        }
+        pthread_attr_destroy(&attr);
     }
+
+    // Workers do not steal until the first Cilkified region starts, so they
+    // will see their victim lists.
+    topology_init(g, worker_cpus);
+    free(worker_cpus);
+
     usleep(10);
 }
 
-global_state *__cilkrts_startup(int argc, char *argv[]) {
-    cilkrts_alert(BOOT, NULL, "(__cilkrts_startup) argc %d", argc);
-    global_state *g = global_state_init(argc, argv);
+static void __cilkrts_start_workers(global_state *g);
+static void start_shared_workers(global_state *g);
+
+static inline bool prewarm_enabled(global_state *g) {
+    return g->options.fiber_prewarm || g->options.fiber_prewarm_global;
+}
+
+// For a runtime created by cilk_thrd_init, start the workers now and wait
+// for each of them to fill its fiber pool on its own thread, so that the
+// first Cilkified region does not pay for mapping stacks and faulting them
+// in.  The default runtime is created before main, when Cilksan may still
+// change its number of workers, so its workers prewarm when the first
+// Cilkified region starts them.
+static void prewarm_workers(global_state *g) {
+    if (!prewarm_enabled(g))
+        return;
+    if (g->options.max_roots)
+        start_shared_workers(g);
+    else
+        __cilkrts_start_workers(g);
+    while (atomic_load_explicit(&g->prewarm_pending, memory_order_acquire))
+        usleep(10);
+}
+
+global_state *__cilkrts_startup(const cilk_config_t *config,
+                                unsigned int max_roots) {
+    cilkrts_alert(BOOT, NULL, "(__cilkrts_startup) n_workers %d",
+                  config ? config->n_workers : 0);
+    global_state *g = global_state_init(config, max_roots);
     reducers_init(g);
     __cilkrts_init_tls_variables();
     workers_init(g);
@@ -273,20 +419,20 @@ global_state *__cilkrts_startup(int argc, char *argv[]) {
     CILK_ASSERT_G(0 == g->exiting_worker);
     reducers_import(g, g->workers[g->exiting_worker]);
 
-    // Create the root closure and a fiber to go with it.  Use worker 0 to
-    // allocate the closure and fiber.
-    Closure *t = Closure_create(g->workers[g->exiting_worker]);
-    struct cilk_fiber *fiber = cilk_fiber_allocate(
-        g->workers[g->exiting_worker], g->options.stacksize);
-    t->fiber = fiber;
-    g->root_closure = t;
+    // Create the root closures and fibers to go with them.  Use worker 0 to
+    // allocate the closures and fibers.
+    roots_init(g, g->workers[g->exiting_worker]);
+
+    arbiter_register(g);
+    if (config)
+        prewarm_workers(g);
 
     return g;
 }
 
 // Global constructor for starting up the default cilkrts.
 __attribute__((constructor)) void __default_cilkrts_startup() {
-    default_cilkrts = __cilkrts_startup(0, NULL);
+    default_cilkrts = __cilkrts_startup(NULL, 0);
     my_cilkrts = default_cilkrts;
 
     for (unsigned i = 0; i < cilkrts_callbacks.last_init; ++i)
@@ -304,21 +450,58 @@ void __cilkrts_internal_set_force_reduce(unsigned int force_reduce) {
     set_force_reduce(default_cilkrts, force_reduce);
 }
 
+// A runtime with one worker, which is common when every multicilk runtime
+// owns one pinned core, has no thieves.  Its worker then skips the deque
+// pushes and the Dekker protocol on spawn and return, never tries to steal,
+// and, unless the runtime runs several roots, is the Cilkifying thread
+// itself.  This is decided when the workers start rather than in
+// __cilkrts_startup, because Cilksan sets nworkers and force_reduce in
+// between, and forced reductions steal from the worker's own deque.
+static void serial_init(global_state *g) {
+    if (!g->options.serial || g->nworkers != 1 || g->options.force_reduce)
+        return;
+    cilkrts_alert(BOOT, NULL, "(serial_init) Running one worker serially");
+    g->workers[0]->serial = true;
+    if (!g->options.max_roots)
+        g->options.boss_worker = 1;
+}
+
 // Start the Cilk workers in g, for example, by creating their underlying
 // Pthreads.
 static void __cilkrts_start_workers(global_state *g) {
+    serial_init(g);
+    bool prewarm = prewarm_enabled(g);
+    if (prewarm) {
+        cilkrts_alert(BOOT, NULL, "(start_workers) prewarming %u fibers per "
+                      "worker", g->options.fiber_prewarm);
+        atomic_store_explicit(&g->prewarm_pending, g->nworkers,
+                              memory_order_relaxed);
+    }
     threads_init(g);
     g->workers_started = true;
+    // The boss worker has no thread of its own.
+    if (prewarm && is_boss_worker(g, BOSS_WORKER)) {
+        cilk_fiber_pool_per_worker_prewarm(g->workers[BOSS_WORKER]);
+        atomic_fetch_sub_explicit(&g->prewarm_pending, 1,
+                                  memory_order_release);
+    }
 }
 
 // Stop the Cilk workers in g, for example, by joining their underlying Pthreads.
 static void __cilkrts_stop_workers(global_state *g) {
-    CILK_ASSERT_G(!atomic_load_explicit(&g->start, memory_order_acquire));
+    CILK_ASSERT_G(g->options.max_roots ||
+                  !atomic_load_explicit(&g->start, memory_order_acquire));
     CILK_ASSERT_G(CLOSURE_READY != g->root_closure->status);
 
     // Set g->start and g->terminate, to allow the workers to exit their
     // outermost scheduling loop.  Wake up any workers waiting on g->start.
     g->terminate = true;
+    if (g->options.max_roots) {
+        // Workers of a multi-root runtime are still in the work-stealing
+        // loop.
+        atomic_store_explicit(&g->done, 1, memory_order_release);
+        worker_wake_all(g);
+    }
     pthread_mutex_lock(&(g->start_lock));
     atomic_store_explicit(&g->start, 1, memory_order_release);
     pthread_cond_broadcast(&g->start_cond_var);
@@ -326,6 +509,8 @@ static void __cilkrts_stop_workers(global_state *g) {
 
     // Join the worker pthreads
     for (unsigned int i = 0; i < g->nworkers; i++) {
+        if (is_boss_worker(g, i))
+            continue;
         int status = pthread_join(g->threads[i], NULL);
         if (status != 0)
             cilkrts_bug(NULL, "Cilk runtime error: thread join (%u) failed: %d",
@@ -335,25 +520,38 @@ static void __cilkrts_stop_workers(global_state *g) {
     g->workers_started = false;
 }
 
-// Setup runtime structures to start a new Cilkified region.  Executed by the
-// Cilkifying thread in cilkify().
-void invoke_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
-    // NOTE(TFK): Maybe comment out this assert.
-    CILK_ASSERT_G(!__cilkrts_get_tls_worker());
+// The root of the Cilkified region the calling thread is waiting for, in a
+// multi-root runtime.
+static __thread struct cilk_root *current_root = NULL;
 
-    // Start the workers if necessary
-    if (!g->workers_started)
+// Start the workers of a multi-root runtime, which then stay in the
+// work-stealing loop until shutdown.
+static void start_shared_workers(global_state *g) {
+    pthread_mutex_lock(&g->roots_lock);
+    if (!g->workers_started) {
         __cilkrts_start_workers(g);
+        atomic_store_explicit(&g->cilkified, 1, memory_order_release);
+        atomic_store_explicit(&g->done, 0, memory_order_release);
+        pthread_mutex_lock(&(g->start_lock));
+        atomic_store_explicit(&g->start, 1, memory_order_release);
+        pthread_cond_broadcast(&g->start_cond_var);
+        pthread_mutex_unlock(&(g->start_lock));
+    }
+    pthread_mutex_unlock(&g->roots_lock);
+}
+
+// Make the closure of root ready to resume sf on the root's fiber.
+static void prepare_root(struct cilk_root *root, __cilkrts_stack_frame *sf) {
+    Closure *t = root->closure;
 
     // Mark the root closure as not initialized
-    g->root_closure_initialized = false;
+    root->initialized = false;
 
     // Mark the root closure as ready
-    Closure_make_ready(g->root_closure);
+    Closure_make_ready(t);
 
     // Setup the stack pointer to point at the root closure's fiber.
-    void *new_rsp =
-        (void *)sysdep_reset_stack_for_resume(g->root_closure->fiber, sf);
+    void *new_rsp = (void *)sysdep_reset_stack_for_resume(t->fiber, sf);
     USE_UNUSED(new_rsp);
     CILK_ASSERT_G(SP(sf) == new_rsp);
 
@@ -363,7 +561,32 @@ void invoke_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
     __cilkrts_set_stolen(sf);
 
     // Associate sf with this root closure
-    g->root_closure->frame = sf;
+    t->frame = sf;
+}
+
+// Setup runtime structures to start a new Cilkified region.  Executed by the
+// Cilkifying thread in cilkify().
+void invoke_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
+    // NOTE(TFK): Maybe comment out this assert.
+    CILK_ASSERT_G(!__cilkrts_get_tls_worker());
+    atomic_fetch_add_explicit(&g->regions, 1, memory_order_relaxed);
+
+    if (g->options.max_roots) {
+        if (!g->workers_started)
+            start_shared_workers(g);
+        // Blocks while max_roots other threads are in Cilkified regions.
+        struct cilk_root *root = root_acquire(g);
+        prepare_root(root, sf);
+        current_root = root;
+        root_submit(g, root);
+        return;
+    }
+
+    // Start the workers if necessary
+    if (!g->workers_started)
+        __cilkrts_start_workers(g);
+
+    prepare_root(&g->roots[0], sf);
 
     // Now we kick off execution of the Cilkified region by setting appropriate
     // flags:
@@ -374,58 +597,105 @@ void invoke_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
     // Set g->done = 0, so Cilk workers will continue trying to steal.
     atomic_store_explicit(&g->done, 0, memory_order_release);
     // Set g->start = 1 to unleash workers to enter the work-stealing loop.
-    // Wake up any workers waiting for this flag.
-    pthread_mutex_lock(&(g->start_lock));
-    atomic_store_explicit(&g->start, 1, memory_order_release);
-    pthread_cond_broadcast(&g->start_cond_var);
-    pthread_mutex_unlock(&(g->start_lock));
+    // Wake up any workers sleeping on this flag; spinning workers see it.
+    atomic_store_explicit(&g->start, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&g->start_sleepers, memory_order_seq_cst)) {
+        pthread_mutex_lock(&(g->start_lock));
+        pthread_cond_broadcast(&g->start_cond_var);
+        pthread_mutex_unlock(&(g->start_lock));
+    }
 }
 
 // Block until signaled the Cilkified region is done.  Executed by the Cilkfying
-// thread.
+// thread.  With the boss_worker option, the Cilkifying thread first works on
+// the region as worker BOSS_WORKER, which saves the start and cilkified
+// handoffs whenever it is the worker that starts or finishes the region.
 void wait_until_cilk_done(global_state *g) {
+    if (g->options.max_roots) {
+        struct cilk_root *root = current_root;
+        current_root = NULL;
+        root_wait(g, root);
+        root_release(g, root);
+        return;
+    }
+
+    if (g->options.boss_worker) {
+        __cilkrts_worker *w = g->workers[BOSS_WORKER];
+        __cilkrts_set_tls_worker(w);
+        worker_run_region(w);
+        __cilkrts_set_tls_worker(NULL);
+    }
+
     // Wait on g->cilkified to be set to 0, indicating the end of the Cilkified
     // region.  We use a condition variable to wait on g->cilkified, because
     // this approach seems to result in better performance.
 
+    // Short regions finish within the spin window.
+    if (spin_on_flag(&g->cilkified, false, g->options.handoff_spin))
+        return;
+
     // TODO: Convert pthread_mutex_lock, pthread_mutex_unlock, and
     // pthread_cond_wait to cilk_* equivalents.
     pthread_mutex_lock(&(g->cilkified_lock));
+    atomic_store_explicit(&g->cilkified_sleeping, 1, memory_order_seq_cst);
 
     // There may be a *very unlikely* scenario where the Cilk computation has
     // already been completed before even starting to wait.  In that case, do
     // not wait and continue directly.  Also handle spurious wakeups with a
     // 'while' instead of an 'if'.
-    while (atomic_load_explicit(&g->cilkified, memory_order_acquire)) {
+    while (atomic_load_explicit(&g->cilkified, memory_order_seq_cst)) {
         pthread_cond_wait(&(g->cilkified_cond_var), &(g->cilkified_lock));
     }
 
+    atomic_store_explicit(&g->cilkified_sleeping, 0, memory_order_relaxed);
     pthread_mutex_unlock(&(g->cilkified_lock));
 }
 
 // Finish the execution of a Cilkified region.  Executed by a worker in g.
 void exit_cilkified_root(global_state *g, __cilkrts_stack_frame *sf) {
     __cilkrts_worker *w = sf->worker;
+    Closure *t =
+        atomic_load_explicit(&g->deques[w->self].bottom, memory_order_relaxed);
+    CILK_ASSERT(w, t && t->root && t->frame == sf);
+    struct cilk_root *root = t->root;
 
     // Record this worker as the exiting worker.  We keep track of this exiting
     // worker so that code outside of Cilkified regions can use this worker's
     // state, specifically, its reducer_map.  We make sure to do this before
     // setting done, so that other workers will properly observe the new
     // exiting_worker.
-    g->exiting_worker = w->self;
-
-    // Mark the computation as done.  Also set start to false, so workers who
-    // exit the work-stealing loop will return to waiting for the start of the
-    // next Cilkified region.
-    atomic_store_explicit(&g->start, 0, memory_order_release);
-    atomic_store_explicit(&g->done, 1, memory_order_release);
+    root->exiting_worker = w->self;
+
+    if (g->options.max_roots) {
+        // Other regions may run on this worker before this root's thread
+        // runs another one, so this worker cannot keep the region's reducer
+        // views.
+        reducers_reduce_into_leftmost(w);
+        // Have the scheduler complete the root once w is off its fiber.
+        w->l->finished_root = root;
+    } else {
+        g->exiting_worker = w->self;
+
+        // Mark the computation as done.  Also set start to false, so workers
+        // who exit the work-stealing loop will return to waiting for the start
+        // of the next Cilkified region.
+        atomic_store_explicit(&g->start, 0, memory_order_release);
+        atomic_store_explicit(&g->done, 1, memory_order_release);
+        // Parked workers must see done to leave the work-stealing loop.
+        worker_wake_all(g);
+    }
 
     // Clear this worker's deque.  Nobody can successfully steal from this deque
     // at this point, because head == tail, but we still want any subsequent
-    // Cilkified region to start with an empty deque.
-    g->deques[w->self].bottom = (Closure *)NULL;
-    g->deques[w->self].top = (Closure *)NULL;
-    WHEN_CILK_DEBUG(g->root_closure->owner_ready_deque = NO_WORKER);
+    // Cilkified region to start with an empty deque.  Thieves may still peek
+    // at the root closure until the deque is cleared.
+    deque_lock_self(w);
+    CILK_ASSERT(w, deque_stash_size(&g->deques[w->self]) == 0);
+    atomic_store_explicit(&g->deques[w->self].bottom, NULL,
+                          memory_order_relaxed);
+    atomic_store_explicit(&g->deques[w->self].top, NULL, memory_order_relaxed);
+    Closure_set_owner_deque(t, NO_WORKER);
+    deque_unlock_self(w);
 
     // Clear the flags in sf.  This routine runs before leave_frame in a Cilk
     // function, but leave_frame is executed conditionally in Cilk functions
@@ -442,6 +712,8 @@ static void global_state_terminate(global_state *g) {
     cilk_fiber_pool_global_terminate(g); /* before malloc terminate */
     cilk_internal_malloc_global_terminate(g);
     cilk_sched_stats_print(g);
+    if (ALERT_ENABLED(SCHED_SUMMARY))
+        cilk_sched_counters_print(g);
 }
 
 static void global_state_deinit(global_state *g) {
@@ -450,6 +722,7 @@ static void global_state_deinit(global_state *g) {
     cilk_fiber_pool_global_destroy(g);
     cilk_internal_malloc_global_destroy(g); // internal malloc last
     cilk_mutex_destroy(&(g->print_lock));
+    cilk_mutex_destroy(&(g->counters_lock));
     // TODO: Convert to cilk_* equivalents
     pthread_mutex_destroy(&g->cilkified_lock);
     pthread_cond_destroy(&g->cilkified_cond_var);
@@ -515,6 +788,8 @@ static void workers_deinit(global_state *g) {
             CILK_ASSERT_INDEX_ZERO(NULL, allocations, i, , "%ld");
     }
 
+    topology_deinit(g);
+
     unsigned i = g->options.nproc;
     while (i-- > 0) {
         __cilkrts_worker *w = g->workers[i];
@@ -522,15 +797,19 @@ static void workers_deinit(global_state *g) {
         cilk_internal_malloc_per_worker_destroy(w); // internal malloc last
         free(w->l->shadow_stack);
         w->l->shadow_stack = NULL;
-        free(w->l);
         w->l = NULL;
-        free(w);
+        free(w); // and its local state
     }
 
     /* TODO: Export initial reducer map */
 }
 
 CHEETAH_INTERNAL void __cilkrts_shutdown(global_state *g) {
+    // Finish the regions queued by cilk_thrd_async while there are workers.
+    async_deinit(g);
+
+    arbiter_unregister(g);
+
     // If the workers are still running, stop them now.
     if (g->workers_started)
         __cilkrts_stop_workers(g);
@@ -538,9 +817,8 @@ CHEETAH_INTERNAL void __cilkrts_shutdown(global_state *g) {
     for (unsigned i = cilkrts_callbacks.last_exit; i > 0;)
         cilkrts_callbacks.exit[--i]();
 
-    // Deallocate the root closure and its fiber
-    cilk_fiber_deallocate_global(g, g->root_closure->fiber);
-    Closure_destroy_global(g, g->root_closure);
+    // Deallocate the root closures and their fibers
+    roots_deinit(g);
 
     // Cleanup the global state
     reducers_deinit(g);
@@ -12,7 +12,11 @@ void exit_cilkified_root(global_state *g, __cilkrts_stack_frame *sf);
 void __cilkrts_internal_set_nworkers(unsigned int nworkers);
 void __cilkrts_internal_set_force_reduce(unsigned int force_reduce);
 
-global_state *__cilkrts_startup(int argc, char *argv[]);
+// Create a runtime from config, or from the defaults and the environment if
+// config is NULL.  If max_roots > 0, up to max_roots threads may run
+// Cilkified regions on the runtime at once.
+global_state *__cilkrts_startup(const cilk_config_t *config,
+                                unsigned int max_roots);
 void __cilkrts_shutdown(global_state *g);
 
 #endif /* _CILK_INIT_H */
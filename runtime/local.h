@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 
+#include "topology.h"
+
 struct local_state {
     struct __cilkrts_stack_frame **shadow_stack;
 
@@ -10,12 +12,24 @@ struct local_state {
     bool lock_wait;
     bool provably_good_steal;
     unsigned int rand_next;
+    worker_id last_victim; /* for STEAL_POLICY_LAST_VICTIM */
+    bool hungry; /* counted as an idle thief; see park.h */
+    unsigned int idle_group; /* counter of idle thieves, by socket */
+    /* workers running children of the last failed sync; see scheduler.c */
+    worker_id leapfrog[CILK_LEAPFROG_VICTIMS];
+    unsigned int nleapfrog;
 
     jmpbuf rts_ctx;
     struct cilk_fiber_pool fiber_pool;
     struct cilk_im_desc im_desc;
     struct cilk_fiber *fiber_to_free;
+    struct cilk_root *finished_root; /* see roots.c */
     struct sched_stats stats;
+    struct sched_counters counters;
+#if CILK_MUTEX_STATS
+    struct cilk_mutex_stats closure_lock_stats; /* of destroyed closures */
+#endif
+    struct victim_list victims;
 };
 
 #endif /* _CILK_LOCAL_H */
@@ -0,0 +1,195 @@
+// Statically partitioned parallel loops.
+//
+// __cilkrts_static_for runs a loop body over a range of iterations without
+// spawning.  The range is cut into chunks, and the chunks into one block per
+// worker of the runtime, as with OpenMP's static schedule.  The calling
+// worker publishes the loop in g->loop and wakes parked workers.  Workers in
+// the steal loop join it before trying to steal:
+//
+//   - Each participant first runs the chunks of its own block, in order.
+//   - It then takes chunks from the front of the other blocks, so the blocks
+//     of workers that are busy elsewhere, or slow, are still run.
+//   - Once every chunk is taken, the caller unpublishes the loop and waits
+//     for the workers helping with it to finish their last chunk.
+//
+// Reducer views follow the serial order of the chunks.  A participant keeps
+// one reducer map for each run of consecutive chunks it executes and leaves
+// it in the slot of the run's first chunk.  The caller then merges its own
+// map from before the loop with the slots in chunk order.
+//
+// The body runs on a worker's scheduling stack, outside any Cilk frame, so it
+// must not spawn or sync.  A runtime runs one such loop at a time; a loop
+// started while another is published runs serially on its caller.
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cilk/cilk_api.h>
+
+#include "cilk-internal.h"
+#include "debug.h"
+#include "global.h"
+#include "loop.h"
+#include "park.h"
+#include "reducer_impl.h"
+#include "scheduler.h"
+
+// With grain 0, aim for this many chunks per worker.
+#define LOOP_DEFAULT_CHUNKS_PER_WORKER 8
+// Larger grains are used if needed to stay within this many chunks per
+// worker, which bounds the reducer slots.
+#define LOOP_MAX_CHUNKS_PER_WORKER 64
+
+struct loop_block {
+    atomic_long next; // next chunk to take
+    long end;         // one past the last chunk of this block
+} __attribute__((aligned(CILK_CACHE_LINE)));
+
+struct cilk_loop {
+    void (*body)(long, long, void *);
+    void *data;
+    long begin, end, grain;
+    unsigned int nblocks;
+    long nchunks;
+    struct loop_block *blocks;
+    // The reducer map of the run of chunks starting at each chunk, if any
+    cilkred_map **rmaps;
+};
+
+// Leave w's reducer views of the run of chunks starting at first.
+static void loop_deposit(__cilkrts_worker *w, struct cilk_loop *loop,
+                         long first) {
+    if (first < 0 || !w->reducer_map)
+        return;
+    loop->rmaps[first] = w->reducer_map;
+    w->reducer_map = NULL;
+}
+
+// Run chunks of loop until none are left, starting with w's own block.
+static bool loop_run(__cilkrts_worker *w, struct cilk_loop *loop) {
+    long first = -1, last = -1;
+    unsigned int nblocks = loop->nblocks;
+    for (unsigned int i = 0; i < nblocks; ++i) {
+        struct loop_block *b = &loop->blocks[(w->self + i) % nblocks];
+        while (atomic_load_explicit(&b->next, memory_order_relaxed) < b->end) {
+            long c = atomic_fetch_add_explicit(&b->next, 1,
+                                               memory_order_relaxed);
+            if (c >= b->end)
+                break;
+            if (c != last + 1) {
+                loop_deposit(w, loop, first);
+                first = c;
+            }
+            long lo = loop->begin + c * loop->grain;
+            long hi = loop->end - lo > loop->grain ? lo + loop->grain
+                                                   : loop->end;
+            loop->body(lo, hi, loop->data);
+            last = c;
+        }
+    }
+    loop_deposit(w, loop, first);
+    return first >= 0;
+}
+
+bool loop_join(__cilkrts_worker *w) {
+    global_state *g = w->g;
+    // The loop lives on its caller's stack.  Count ourselves as a helper
+    // before reading it, so that either its caller waits for us or we see
+    // that it is gone.
+    atomic_fetch_add_explicit(&g->loop_helpers, 1, memory_order_seq_cst);
+    bool ran = false;
+    struct cilk_loop *loop =
+        atomic_load_explicit(&g->loop, memory_order_seq_cst);
+    if (loop) {
+        cilkrts_alert(SCHED, w, "(loop_join) loop %p", (void *)loop);
+        ran = loop_run(w, loop);
+    }
+    atomic_fetch_sub_explicit(&g->loop_helpers, 1, memory_order_release);
+    return ran;
+}
+
+void __cilkrts_static_for(void (*body)(long, long, void *), void *data,
+                          long begin, long end, long grain) {
+    if (end <= begin)
+        return;
+    __cilkrts_worker *w = __cilkrts_get_tls_worker();
+    if (!w || w->g->nworkers == 1) {
+        body(begin, end, data);
+        return;
+    }
+    global_state *g = w->g;
+
+    struct cilk_loop loop;
+    loop.body = body;
+    loop.data = data;
+    loop.begin = begin;
+    loop.end = end;
+    loop.nblocks = g->nworkers;
+    long n = end - begin;
+    long max_chunks = (long)loop.nblocks * LOOP_MAX_CHUNKS_PER_WORKER;
+    if (grain <= 0)
+        grain = n / ((long)loop.nblocks * LOOP_DEFAULT_CHUNKS_PER_WORKER);
+    if (grain < 1)
+        grain = 1;
+    if ((n + grain - 1) / grain > max_chunks)
+        grain = (n + max_chunks - 1) / max_chunks;
+    loop.grain = grain;
+    loop.nchunks = (n + grain - 1) / grain;
+    if (loop.nchunks == 1) {
+        body(begin, end, data);
+        return;
+    }
+
+    loop.blocks = (struct loop_block *)cilk_aligned_alloc(
+        __alignof__(struct loop_block),
+        loop.nblocks * sizeof(struct loop_block));
+    for (unsigned int i = 0; i < loop.nblocks; ++i) {
+        atomic_store_explicit(&loop.blocks[i].next,
+                              loop.nchunks * i / loop.nblocks,
+                              memory_order_relaxed);
+        loop.blocks[i].end = loop.nchunks * (i + 1) / loop.nblocks;
+    }
+    loop.rmaps = (cilkred_map **)calloc(loop.nchunks, sizeof(cilkred_map *));
+
+    struct cilk_loop *expected = NULL;
+    if (!atomic_compare_exchange_strong_explicit(&g->loop, &expected, &loop,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        // Another loop is running.  Do this one on our own.
+        free(loop.rmaps);
+        free(loop.blocks);
+        body(begin, end, data);
+        return;
+    }
+    cilkrts_alert(SCHED, w, "(__cilkrts_static_for) %ld chunks of %ld",
+                  loop.nchunks, grain);
+
+    // The views from before the loop are leftmost.
+    cilkred_map *left = w->reducer_map;
+    w->reducer_map = NULL;
+
+    worker_wake_all(g);
+    loop_run(w, &loop);
+
+    // Every chunk has been taken.  Wait for the helpers to finish theirs.
+    atomic_store_explicit(&g->loop, NULL, memory_order_seq_cst);
+    while (atomic_load_explicit(&g->loop_helpers, memory_order_seq_cst)) {
+#ifdef __SSE__
+        __builtin_ia32_pause();
+#endif
+#ifdef __aarch64__
+        __builtin_arm_yield();
+#endif
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    for (long c = 0; c < loop.nchunks; ++c) {
+        if (loop.rmaps[c])
+            left = merge_two_rmaps(w, left, loop.rmaps[c]);
+    }
+    w->reducer_map = left;
+
+    free(loop.rmaps);
+    free(loop.blocks);
+}
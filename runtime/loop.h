@@ -0,0 +1,21 @@
+#ifndef _CILK_LOOP_H
+#define _CILK_LOOP_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "cilk-internal.h"
+#include "global.h"
+
+// Help run the parallel loop published in w's runtime by __cilkrts_static_for,
+// if there is one.  Returns true if w ran any iterations.  Called from the
+// steal loop.
+CHEETAH_INTERNAL bool loop_join(__cilkrts_worker *w);
+
+static inline bool loop_help(__cilkrts_worker *w) {
+    if (atomic_load_explicit(&w->g->loop, memory_order_relaxed) == NULL)
+        return false;
+    return loop_join(w);
+}
+
+#endif /* _CILK_LOOP_H */
@@ -1,10 +1,234 @@
 #include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "mutex.h"
 
-void cilk_mutex_init(cilk_mutex *lock) {
+#if CILK_MUTEX_IMPL == MUTEX_FUTEX
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <sched.h>
+#endif
+#endif
+
+// Every lock first tries to take the lock outright with mutex_try_impl.  If
+// that fails, the lock is contended and mutex_lock_slow waits for it in the
+// way of the configured implementation.  Statistics are updated after the
+// lock is acquired, so they need no synchronization of their own.
+
+static inline void cpu_relax(void) {
+#if defined __i386__ || defined __x86_64__
+    __builtin_ia32_pause();
+#elif defined __aarch64__
+    __asm__ volatile("yield");
+#endif
+}
+
+#if CILK_MUTEX_STATS
+// Where there is no cheap cycle counter, count spin iterations instead.
+static inline uint64_t wait_clock(uint64_t spins) {
+#if defined __i386__ || defined __x86_64__
+    (void)spins;
+    return __builtin_ia32_rdtsc();
+#elif defined __aarch64__
+    uint64_t t;
+    (void)spins;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+#else
+    return spins;
+#endif
+}
+#endif
+
+#if CILK_MUTEX_IMPL == MUTEX_TICKET
+
+static inline void mutex_init_impl(cilk_mutex *lock) {
+    atomic_store_explicit(&lock->next, 0, memory_order_relaxed);
+    atomic_store_explicit(&lock->owner, 0, memory_order_relaxed);
+}
+
+static inline bool mutex_try_impl(cilk_mutex *lock) {
+    unsigned int t = atomic_load_explicit(&lock->owner, memory_order_relaxed);
+    return atomic_compare_exchange_strong_explicit(
+        &lock->next, &t, t + 1, memory_order_acquire, memory_order_relaxed);
+}
+
+static uint64_t mutex_lock_slow(cilk_mutex *lock) {
+    uint64_t spins = 0;
+    unsigned int t = atomic_fetch_add_explicit(&lock->next, 1,
+                                               memory_order_relaxed);
+    while (1) {
+        unsigned int ahead =
+            t - atomic_load_explicit(&lock->owner, memory_order_acquire);
+        if (ahead == 0)
+            return spins;
+        // Back off in proportion to the number of threads ahead of us.
+        for (unsigned int i = 0; i < ahead; ++i, ++spins)
+            cpu_relax();
+    }
+}
+
+static inline void mutex_unlock_impl(cilk_mutex *lock) {
+    unsigned int t = atomic_load_explicit(&lock->owner, memory_order_relaxed);
+    atomic_store_explicit(&lock->owner, t + 1, memory_order_release);
+}
+
+static inline void mutex_destroy_impl(cilk_mutex *lock) {}
+
+#elif CILK_MUTEX_IMPL == MUTEX_MCS
+
+// Locks nest only a few deep (a deque, then a closure and its parent), and
+// need not be released in the order they were acquired, so each thread keeps
+// a small set of queue nodes and takes any free one.
+#define MCS_NODES 8
+
+struct cilk_mutex_qnode {
+    _Atomic(struct cilk_mutex_qnode *) next;
+    atomic_bool waiting;
+    bool in_use;
+} __attribute__((aligned(CILK_CACHE_LINE)));
+
+static __thread struct cilk_mutex_qnode mcs_nodes[MCS_NODES];
+
+static struct cilk_mutex_qnode *mcs_node_get(void) {
+    for (int i = 0; i < MCS_NODES; ++i) {
+        struct cilk_mutex_qnode *node = &mcs_nodes[i];
+        if (!node->in_use) {
+            node->in_use = true;
+            atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+            return node;
+        }
+    }
+    fprintf(stderr, "Cilk: too many nested locks\n");
+    abort();
+}
+
+static inline void mcs_node_put(struct cilk_mutex_qnode *node) {
+    node->in_use = false;
+}
+
+static inline void mutex_init_impl(cilk_mutex *lock) {
+    atomic_store_explicit(&lock->tail, NULL, memory_order_relaxed);
+    lock->holder = NULL;
+}
+
+static inline bool mutex_try_impl(cilk_mutex *lock) {
+    if (atomic_load_explicit(&lock->tail, memory_order_relaxed))
+        return false;
+    struct cilk_mutex_qnode *node = mcs_node_get(), *expected = NULL;
+    if (atomic_compare_exchange_strong_explicit(&lock->tail, &expected, node,
+                                                memory_order_acquire,
+                                                memory_order_relaxed)) {
+        lock->holder = node;
+        return true;
+    }
+    mcs_node_put(node);
+    return false;
+}
+
+static uint64_t mutex_lock_slow(cilk_mutex *lock) {
+    uint64_t spins = 0;
+    struct cilk_mutex_qnode *node = mcs_node_get();
+    atomic_store_explicit(&node->waiting, true, memory_order_relaxed);
+    struct cilk_mutex_qnode *pred =
+        atomic_exchange_explicit(&lock->tail, node, memory_order_acq_rel);
+    if (pred) {
+        atomic_store_explicit(&pred->next, node, memory_order_release);
+        while (atomic_load_explicit(&node->waiting, memory_order_acquire)) {
+            cpu_relax();
+            ++spins;
+        }
+    }
+    lock->holder = node;
+    return spins;
+}
+
+static inline void mutex_unlock_impl(cilk_mutex *lock) {
+    struct cilk_mutex_qnode *node = lock->holder;
+    struct cilk_mutex_qnode *next =
+        atomic_load_explicit(&node->next, memory_order_acquire);
+    if (!next) {
+        struct cilk_mutex_qnode *expected = node;
+        if (atomic_compare_exchange_strong_explicit(&lock->tail, &expected,
+                                                    NULL, memory_order_release,
+                                                    memory_order_relaxed)) {
+            mcs_node_put(node);
+            return;
+        }
+        // A waiter has swapped itself in but not yet linked to us.
+        while (!(next = atomic_load_explicit(&node->next,
+                                             memory_order_acquire)))
+            cpu_relax();
+    }
+    atomic_store_explicit(&next->waiting, false, memory_order_release);
+    mcs_node_put(node);
+}
+
+static inline void mutex_destroy_impl(cilk_mutex *lock) {}
+
+#elif CILK_MUTEX_IMPL == MUTEX_FUTEX
+
+// Spin this many times before sleeping; most critical sections in the
+// runtime are shorter than a system call.
+#define FUTEX_SPIN 128
+
+#ifdef __linux__
+static void futex_wait(atomic_uint *addr, unsigned int val) {
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAIT_PRIVATE, val, NULL,
+            NULL, 0);
+}
+
+static void futex_wake(atomic_uint *addr, int count) {
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAKE_PRIVATE, count, NULL,
+            NULL, 0);
+}
+#else
+static void futex_wait(atomic_uint *addr, unsigned int val) { sched_yield(); }
+static void futex_wake(atomic_uint *addr, int count) {}
+#endif
+
+static inline void mutex_init_impl(cilk_mutex *lock) {
+    atomic_store_explicit(&lock->state, 0, memory_order_relaxed);
+}
+
+static inline bool mutex_try_impl(cilk_mutex *lock) {
+    unsigned int expected = 0;
+    return atomic_compare_exchange_strong_explicit(
+        &lock->state, &expected, 1, memory_order_acquire,
+        memory_order_relaxed);
+}
+
+static uint64_t mutex_lock_slow(cilk_mutex *lock) {
+    uint64_t spins = 0;
+    for (; spins < FUTEX_SPIN; ++spins) {
+        if (atomic_load_explicit(&lock->state, memory_order_relaxed) == 0 &&
+            mutex_try_impl(lock))
+            return spins;
+        cpu_relax();
+    }
+    // State 2 tells the holder that it must wake someone on unlock.
+    while (atomic_exchange_explicit(&lock->state, 2, memory_order_acquire)) {
+        futex_wait(&lock->state, 2);
+        ++spins;
+    }
+    return spins;
+}
+
+static inline void mutex_unlock_impl(cilk_mutex *lock) {
+    if (atomic_exchange_explicit(&lock->state, 0, memory_order_release) == 2)
+        futex_wake(&lock->state, 1);
+}
+
+static inline void mutex_destroy_impl(cilk_mutex *lock) {}
+
+#else // MUTEX_PTHREAD
+
+static inline void mutex_init_impl(cilk_mutex *lock) {
 #if USE_SPINLOCK
     int ret = pthread_spin_init(&(lock->posix), PTHREAD_PROCESS_PRIVATE);
     if (ret != 0) {
@@ -17,15 +241,24 @@ void cilk_mutex_init(cilk_mutex *lock) {
 #endif
 }
 
-void cilk_mutex_lock(cilk_mutex *lock) {
+static inline bool mutex_try_impl(cilk_mutex *lock) {
+#if USE_SPINLOCK
+    return pthread_spin_trylock(&(lock->posix)) == 0;
+#else
+    return pthread_mutex_trylock(&(lock->posix)) == 0;
+#endif
+}
+
+static uint64_t mutex_lock_slow(cilk_mutex *lock) {
 #if USE_SPINLOCK
     pthread_spin_lock(&(lock->posix));
 #else
     pthread_mutex_lock(&(lock->posix));
 #endif
+    return 0;
 }
 
-void cilk_mutex_unlock(cilk_mutex *lock) {
+static inline void mutex_unlock_impl(cilk_mutex *lock) {
 #if USE_SPINLOCK
     pthread_spin_unlock(&(lock->posix));
 #else
@@ -33,26 +266,53 @@ void cilk_mutex_unlock(cilk_mutex *lock) {
 #endif
 }
 
-int cilk_mutex_try(cilk_mutex *lock) {
+static inline void mutex_destroy_impl(cilk_mutex *lock) {
 #if USE_SPINLOCK
-    if (pthread_spin_trylock(&(lock->posix)) == 0) {
-        return 1;
-    } else {
-        return 0;
-    }
+    pthread_spin_destroy(&(lock->posix));
 #else
-    if (pthread_mutex_trylock(&(lock->posix)) == 0) {
-        return 1;
-    } else {
-        return 0;
-    }
+    pthread_mutex_destroy(&(lock->posix));
 #endif
 }
 
-void cilk_mutex_destroy(cilk_mutex *lock) {
-#if USE_SPINLOCK
-    pthread_spin_destroy(&(lock->posix));
+#endif // CILK_MUTEX_IMPL
+
+void cilk_mutex_init(cilk_mutex *lock) {
+    mutex_init_impl(lock);
+#if CILK_MUTEX_STATS
+    lock->stats.acquire = 0;
+    lock->stats.contended = 0;
+    lock->stats.wait = 0;
+#endif
+}
+
+void cilk_mutex_lock(cilk_mutex *lock) {
+    if (mutex_try_impl(lock)) {
+#if CILK_MUTEX_STATS
+        lock->stats.acquire++;
+#endif
+        return;
+    }
+#if CILK_MUTEX_STATS
+    uint64_t begin = wait_clock(0);
+    uint64_t spins = mutex_lock_slow(lock);
+    lock->stats.wait += wait_clock(spins) - begin;
+    lock->stats.acquire++;
+    lock->stats.contended++;
 #else
-    pthread_mutex_destroy(&(lock->posix));
+    mutex_lock_slow(lock);
+#endif
+}
+
+void cilk_mutex_unlock(cilk_mutex *lock) { mutex_unlock_impl(lock); }
+
+int cilk_mutex_try(cilk_mutex *lock) {
+    if (mutex_try_impl(lock)) {
+#if CILK_MUTEX_STATS
+        lock->stats.acquire++;
 #endif
+        return 1;
+    }
+    return 0;
 }
+
+void cilk_mutex_destroy(cilk_mutex *lock) { mutex_destroy_impl(lock); }
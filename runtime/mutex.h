@@ -2,10 +2,12 @@
 #define _CILK_MUTEX_H
 
 // Forward declaration
-typedef union cilk_mutex cilk_mutex;
+typedef struct cilk_mutex cilk_mutex;
 
 // Includes
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 #include "rts-config.h"
 
@@ -13,17 +15,37 @@ typedef union cilk_mutex cilk_mutex;
 #define USE_SPINLOCK 1
 #endif
 
-#if USE_SPINLOCK
-union cilk_mutex {
-    volatile int memory;
-    pthread_spinlock_t posix;
+#if CILK_MUTEX_STATS
+// Updated only by the thread holding the lock.
+struct cilk_mutex_stats {
+    uint64_t acquire;   // successful lock and trylock calls
+    uint64_t contended; // lock calls that found the lock held
+    uint64_t wait;      // cycles (or spin iterations) spent waiting
 };
+#endif
+
+// A waiter in an MCS lock queue.  Each thread has a few of these, one for
+// each MCS lock it holds or is waiting for.
+struct cilk_mutex_qnode;
+
+struct cilk_mutex {
+#if CILK_MUTEX_IMPL == MUTEX_TICKET
+    atomic_uint next;  // ticket of the next thread to arrive
+    atomic_uint owner; // ticket of the thread holding the lock
+#elif CILK_MUTEX_IMPL == MUTEX_MCS
+    _Atomic(struct cilk_mutex_qnode *) tail; // last waiter, or NULL if free
+    struct cilk_mutex_qnode *holder;         // node of the holding thread
+#elif CILK_MUTEX_IMPL == MUTEX_FUTEX
+    atomic_uint state; // 0 free, 1 held, 2 held and maybe waited for
+#elif USE_SPINLOCK
+    pthread_spinlock_t posix;
 #else
-union cilk_mutex {
-    volatile int memory;
     pthread_mutex_t posix;
-};
 #endif
+#if CILK_MUTEX_STATS
+    struct cilk_mutex_stats stats;
+#endif
+};
 
 CHEETAH_INTERNAL void cilk_mutex_init(cilk_mutex *lock);
 
@@ -34,4 +56,15 @@ CHEETAH_INTERNAL void cilk_mutex_unlock(cilk_mutex *lock);
 CHEETAH_INTERNAL int cilk_mutex_try(cilk_mutex *lock);
 
 CHEETAH_INTERNAL void cilk_mutex_destroy(cilk_mutex *lock);
+
+#if CILK_MUTEX_STATS
+// Add the counters of lock to sum.  The caller must hold lock or otherwise
+// know that no one else is using it.
+static inline void cilk_mutex_stats_add(struct cilk_mutex_stats *sum,
+                                        const cilk_mutex *lock) {
+    sum->acquire += lock->stats.acquire;
+    sum->contended += lock->stats.contended;
+    sum->wait += lock->stats.wait;
+}
+#endif
 #endif
@@ -0,0 +1,170 @@
+// Parking of idle thieves.
+//
+// A worker that has failed to steal for a while parks on a futex instead of
+// spinning.  Workers that make work available wake parked workers.  Parking
+// uses an eventcount built from two words in global_state:
+//
+//   park_seq: the futex word, incremented on every wakeup
+//   nparked:  the number of workers that are parked or about to park
+//
+// A parking worker reads park_seq, increments nparked, and then checks once
+// more for stealable work before sleeping on park_seq.  A waking worker
+// publishes its work, reads nparked, and, if it is nonzero, increments
+// park_seq before calling futex wake.  Sequentially consistent ordering on
+// both sides (Dekker's protocol again) ensures that either the waker sees
+// the parking worker or the parking worker sees the work.
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "cilk-internal.h"
+#include "global.h"
+#include "local.h"
+#include "park.h"
+#include "readydeque.h"
+
+#if defined __linux__
+static void futex_wait(atomic_uint *addr, unsigned int val) {
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAIT_PRIVATE, val, NULL,
+            NULL, 0);
+}
+
+static void futex_wake(atomic_uint *addr, int count) {
+    syscall(SYS_futex, (unsigned int *)addr, FUTEX_WAKE_PRIVATE, count, NULL,
+            NULL, 0);
+}
+#else
+// Without futexes a parked worker sleeps briefly and then returns to the
+// steal loop, which is the behavior of the old backoff.
+static void futex_wait(atomic_uint *addr, unsigned int val) {
+    if (atomic_load_explicit(addr, memory_order_relaxed) == val)
+        usleep(10);
+}
+
+static void futex_wake(atomic_uint *addr, int count) {}
+#endif
+
+static inline uint64_t park_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Check if any worker in g has a frame that could be stolen.
+static bool stealable_work_exists(global_state *const g) {
+    for (unsigned int i = 0; i < g->nworkers; ++i) {
+        __cilkrts_worker *v = g->workers[i];
+        __cilkrts_stack_frame **head =
+            atomic_load_explicit(&v->head, memory_order_relaxed);
+        __cilkrts_stack_frame **tail =
+            atomic_load_explicit(&v->tail, memory_order_relaxed);
+        if (head < tail || deque_stash_size(&g->deques[i]))
+            return true;
+    }
+    // Loops of __cilkrts_static_for; see loop.c
+    if (atomic_load_explicit(&g->loop, memory_order_seq_cst))
+        return true;
+    // Roots submitted to a multi-root runtime; see roots.c
+    return atomic_load_explicit(&g->nready_roots, memory_order_seq_cst) != 0;
+}
+
+void worker_park(__cilkrts_worker *const w) {
+    global_state *const g = w->g;
+
+    unsigned int seq = atomic_load_explicit(&g->park_seq, memory_order_acquire);
+    atomic_fetch_add_explicit(&g->nparked, 1, memory_order_seq_cst);
+
+    if (!atomic_load_explicit(&g->done, memory_order_seq_cst) &&
+        !stealable_work_exists(g)) {
+        uint64_t begin = park_clock_ns();
+        futex_wait(&g->park_seq, seq);
+        CILK_COUNT(w, COUNTER_PARK);
+        CILK_COUNT_N(w, COUNTER_PARK_NS, park_clock_ns() - begin);
+    }
+
+    atomic_fetch_sub_explicit(&g->nparked, 1, memory_order_release);
+}
+
+static bool wake_one(global_state *const g) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&g->nparked, memory_order_relaxed) == 0)
+        return false;
+    atomic_fetch_add_explicit(&g->park_seq, 1, memory_order_seq_cst);
+    futex_wake(&g->park_seq, 1);
+    return true;
+}
+
+void worker_wake_one(__cilkrts_worker *const w) {
+    if (wake_one(w->g))
+        CILK_COUNT(w, COUNTER_WAKE);
+}
+
+void worker_wake_any(global_state *const g) { wake_one(g); }
+
+void worker_wake_all(global_state *const g) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&g->nparked, memory_order_relaxed) != 0) {
+        atomic_fetch_add_explicit(&g->park_seq, 1, memory_order_seq_cst);
+        futex_wake(&g->park_seq, INT_MAX);
+    }
+    if (atomic_load_explicit(&g->nlent, memory_order_relaxed) != 0) {
+        atomic_fetch_add_explicit(&g->lend_seq, 1, memory_order_seq_cst);
+        futex_wake(&g->lend_seq, INT_MAX);
+    }
+}
+
+// Workers that are lent out wait on a second eventcount, lend_seq and
+// nlent, so that worker_wake_one never wakes a worker that may not steal.
+
+void worker_park_lent(__cilkrts_worker *const w) {
+    global_state *const g = w->g;
+
+    unsigned int seq = atomic_load_explicit(&g->lend_seq, memory_order_acquire);
+    atomic_fetch_add_explicit(&g->nlent, 1, memory_order_seq_cst);
+
+    if (!atomic_load_explicit(&g->done, memory_order_seq_cst) &&
+        worker_is_lent(w)) {
+        uint64_t begin = park_clock_ns();
+        futex_wait(&g->lend_seq, seq);
+        CILK_COUNT_N(w, COUNTER_LENT_NS, park_clock_ns() - begin);
+    }
+
+    atomic_fetch_sub_explicit(&g->nlent, 1, memory_order_release);
+}
+
+void set_active_workers(global_state *const g, unsigned int active) {
+    CILK_ASSERT_G(active >= 1 && active <= g->nworkers);
+    atomic_store_explicit(&g->active_workers, active, memory_order_seq_cst);
+    if (atomic_load_explicit(&g->nlent, memory_order_seq_cst) != 0) {
+        atomic_fetch_add_explicit(&g->lend_seq, 1, memory_order_seq_cst);
+        futex_wake(&g->lend_seq, INT_MAX);
+    }
+}
+
+bool spin_on_flag(volatile atomic_bool *flag, bool want, unsigned int usec) {
+    if (usec == 0)
+        return false;
+    uint64_t deadline = park_clock_ns() + usec * 1000ULL;
+    unsigned int i = 0;
+    while (atomic_load_explicit(flag, memory_order_acquire) != want) {
+        // Reading the clock costs more than a pause, so do it rarely.
+        if (++i % 64 == 0 && park_clock_ns() > deadline)
+            return false;
+#ifdef __SSE__
+        __builtin_ia32_pause();
+#endif
+#ifdef __aarch64__
+        __builtin_arm_yield();
+#endif
+    }
+    return true;
+}
+
+void __cilkrts_wake_thief(__cilkrts_worker *const w) { worker_wake_one(w); }
@@ -0,0 +1,76 @@
+#ifndef _CILK_PARK_H
+#define _CILK_PARK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "cilk-internal.h"
+#include "global.h"
+#include "local.h"
+#include "rts-config.h"
+
+// Park the calling worker, an idle thief, until another worker reports that
+// there may be work to steal or until the current Cilkified region is done.
+// Returns immediately if stealable work is already visible.
+CHEETAH_INTERNAL void worker_park(__cilkrts_worker *const w);
+
+// Wake one parked worker in w's runtime, if there is one.
+CHEETAH_INTERNAL void worker_wake_one(__cilkrts_worker *const w);
+
+// Wake one parked worker in g, if there is one.  For threads that are not
+// workers of g.
+CHEETAH_INTERNAL void worker_wake_any(global_state *const g);
+
+// Wake all parked workers in g, e.g., at the end of a Cilkified region.  The
+// caller must have published the reason for waking before calling this.
+CHEETAH_INTERNAL void worker_wake_all(global_state *const g);
+
+// Workers with IDs at or above g->active_workers are lent out: they stop
+// stealing, so that their CPUs can be used by another runtime.
+static inline bool worker_is_lent(__cilkrts_worker *const w) {
+    return w->self >= atomic_load_explicit(&w->g->active_workers,
+                                           memory_order_relaxed);
+}
+
+// Count w among the idle thieves of its runtime, for
+// __cilkrts_is_anyone_hungry, or stop counting it.  The workers of a socket
+// share a counter, and g->hungry_groups counts the sockets whose counter is
+// nonzero.  So the word that compiled code polls changes only when the first
+// thief of a socket goes idle or the last one finds work.  Racing updates can
+// leave g->hungry_groups briefly off by one, which is harmless for a hint.
+static inline void worker_set_hungry(__cilkrts_worker *const w, bool hungry) {
+    if (w->l->hungry == hungry)
+        return;
+    w->l->hungry = hungry;
+    global_state *g = w->g;
+    atomic_int *nidle = &g->idle_groups[w->l->idle_group].nidle;
+    if (hungry) {
+        if (atomic_fetch_add_explicit(nidle, 1, memory_order_relaxed) == 0)
+            atomic_fetch_add_explicit(&g->hungry_groups, 1,
+                                      memory_order_relaxed);
+    } else {
+        if (atomic_fetch_sub_explicit(nidle, 1, memory_order_relaxed) == 1)
+            atomic_fetch_sub_explicit(&g->hungry_groups, 1,
+                                      memory_order_relaxed);
+    }
+}
+
+// Park the calling worker while it is lent out and the current Cilkified
+// region is not done.
+CHEETAH_INTERNAL void worker_park_lent(__cilkrts_worker *const w);
+
+// Let the first active workers of g steal and lend out the rest.  Wakes
+// lent workers that become active.
+CHEETAH_INTERNAL void set_active_workers(global_state *const g,
+                                         unsigned int active);
+
+// Spin for up to usec microseconds waiting for *flag to become want.  Returns
+// true if it did, in which case the caller need not block.
+CHEETAH_INTERNAL bool spin_on_flag(volatile atomic_bool *flag, bool want,
+                                   unsigned int usec);
+
+// Called from __cilkrts_detach when w pushes onto an empty deque while some
+// workers may be parked.  Must be visible to compiled code.
+void __cilkrts_wake_thief(__cilkrts_worker *const w);
+
+#endif /* _CILK_PARK_H */
@@ -59,29 +59,50 @@ void deque_unlock(__cilkrts_worker *const w, worker_id pn) {
  *
  * ANGE: the precondition of these functions is that the worker w -> self
  * must have locked worker pn's deque before entering the function
+ *
+ * The owner also reads its own bottom without the lock, and top and bottom
+ * are atomic for that; see deque_xtract_bottom_self.  Under the lock relaxed
+ * accesses suffice.
  */
+static inline Closure *get_top(ReadyDeque *d) {
+    return atomic_load_explicit(&d->top, memory_order_relaxed);
+}
+
+static inline Closure *get_bottom(ReadyDeque *d) {
+    return atomic_load_explicit(&d->bottom, memory_order_relaxed);
+}
+
+static inline void set_top(ReadyDeque *d, Closure *cl) {
+    atomic_store_explicit(&d->top, cl, memory_order_relaxed);
+}
+
+static inline void set_bottom(ReadyDeque *d, Closure *cl) {
+    atomic_store_explicit(&d->bottom, cl, memory_order_relaxed);
+}
+
 Closure *deque_xtract_top(__cilkrts_worker *const w, worker_id pn) {
 
     Closure *cl;
+    ReadyDeque *d = &w->g->deques[pn];
 
     /* ANGE: make sure w has the lock on worker pn's deque */
     deque_assert_ownership(w, pn);
 
-    cl = w->g->deques[pn].top;
+    cl = get_top(d);
     if (cl) {
-        CILK_ASSERT(w, cl->owner_ready_deque == pn);
-        w->g->deques[pn].top = cl->next_ready;
+        CILK_ASSERT(w, Closure_owner_deque(cl) == pn);
+        set_top(d, cl->next_ready);
         /* ANGE: if there is only one entry in the deque ... */
-        if (cl == w->g->deques[pn].bottom) {
+        if (cl == get_bottom(d)) {
             CILK_ASSERT(w, cl->next_ready == (Closure *)NULL);
-            w->g->deques[pn].bottom = (Closure *)NULL;
+            set_bottom(d, (Closure *)NULL);
         } else {
             CILK_ASSERT(w, cl->next_ready);
             (cl->next_ready)->prev_ready = (Closure *)NULL;
         }
-        WHEN_CILK_DEBUG(cl->owner_ready_deque = NO_WORKER);
+        Closure_set_owner_deque(cl, NO_WORKER);
     } else {
-        CILK_ASSERT(w, w->g->deques[pn].bottom == (Closure *)NULL);
+        CILK_ASSERT(w, get_bottom(d) == (Closure *)NULL);
     }
 
     return cl;
@@ -90,21 +111,25 @@ Closure *deque_xtract_top(__cilkrts_worker *const w, worker_id pn) {
 Closure *deque_peek_top(__cilkrts_worker *const w, worker_id pn) {
 
     Closure *cl;
+    ReadyDeque *d = &w->g->deques[pn];
 
     /* ANGE: make sure w has the lock on worker pn's deque */
     deque_assert_ownership(w, pn);
 
     /* ANGE: return the top but does not unlink it from the rest */
-    cl = w->g->deques[pn].top;
+    /* Pairs with the release in deque_add_bottom_self, which publishes a
+       closure on an empty deque without the lock. */
+    cl = atomic_load_explicit(&d->top, memory_order_acquire);
     if (cl) {
         // If w is stealing, then it may peek the top of the deque of the worker
         // who is in the midst of exiting a Cilkified region.  In that case, cl
         // will be the root closure, and cl->owner_ready_deque is not
         // necessarily pn.  The steal will subsequently fail do_dekker_on.
-        CILK_ASSERT(w, cl->owner_ready_deque == pn ||
-                           (w->self != pn && cl == w->g->root_closure));
+        CILK_ASSERT(w, Closure_owner_deque(cl) == pn ||
+                           (w->self != pn && cl->root));
     } else {
-        CILK_ASSERT(w, w->g->deques[pn].bottom == (Closure *)NULL);
+        // The owner may be publishing a closure on its empty deque.
+        CILK_ASSERT(w, get_bottom(d) == (Closure *)NULL || w->self != pn);
     }
 
     return cl;
@@ -113,42 +138,59 @@ Closure *deque_peek_top(__cilkrts_worker *const w, worker_id pn) {
 Closure *deque_xtract_bottom(__cilkrts_worker *const w, worker_id pn) {
 
     Closure *cl;
+    ReadyDeque *d = &w->g->deques[pn];
 
     /* ANGE: make sure w has the lock on worker pn's deque */
     deque_assert_ownership(w, pn);
 
-    cl = w->g->deques[pn].bottom;
+    cl = get_bottom(d);
     if (cl) {
-        CILK_ASSERT(w, cl->owner_ready_deque == pn);
-        w->g->deques[pn].bottom = cl->prev_ready;
-        if (cl == w->g->deques[pn].top) {
+        CILK_ASSERT(w, Closure_owner_deque(cl) == pn);
+        set_bottom(d, cl->prev_ready);
+        if (cl == get_top(d)) {
             CILK_ASSERT(w, cl->prev_ready == (Closure *)NULL);
-            w->g->deques[pn].top = (Closure *)NULL;
+            set_top(d, (Closure *)NULL);
         } else {
             CILK_ASSERT(w, cl->prev_ready);
             (cl->prev_ready)->next_ready = (Closure *)NULL;
         }
 
-        WHEN_CILK_DEBUG(cl->owner_ready_deque = NO_WORKER);
+        Closure_set_owner_deque(cl, NO_WORKER);
     } else {
-        CILK_ASSERT(w, w->g->deques[pn].top == (Closure *)NULL);
+        CILK_ASSERT(w, get_top(d) == (Closure *)NULL);
     }
 
     return cl;
 }
 
+// Only the owner of a deque and thieves stealing from it change it, and a
+// thief can only steal from a deque that has a closure at the top.  An empty
+// deque therefore stays empty until its owner adds to it, and the owner can
+// find its deque empty, or fill it when it is empty, without the lock.
+Closure *deque_xtract_bottom_self(__cilkrts_worker *const w) {
+    ReadyDeque *d = &w->g->deques[w->self];
+    if (get_bottom(d) == NULL)
+        return NULL;
+
+    deque_lock_self(w);
+    Closure *cl = deque_xtract_bottom(w, w->self);
+    deque_unlock_self(w);
+    return cl;
+}
+
 Closure *deque_peek_bottom(__cilkrts_worker *const w, worker_id pn) {
 
     Closure *cl;
+    ReadyDeque *d = &w->g->deques[pn];
 
     /* ANGE: make sure w has the lock on worker pn's deque */
     deque_assert_ownership(w, pn);
 
-    cl = w->g->deques[pn].bottom;
+    cl = get_bottom(d);
     if (cl) {
-        CILK_ASSERT(w, cl->owner_ready_deque == pn);
+        CILK_ASSERT(w, Closure_owner_deque(cl) == pn);
     } else {
-        CILK_ASSERT(w, w->g->deques[pn].top == (Closure *)NULL);
+        CILK_ASSERT(w, get_top(d) == (Closure *)NULL);
     }
 
     return cl;
@@ -167,18 +209,100 @@ void deque_assert_is_bottom(__cilkrts_worker *const w, Closure *t) {
  */
 void deque_add_bottom(__cilkrts_worker *const w, Closure *cl, worker_id pn) {
 
+    ReadyDeque *d = &w->g->deques[pn];
+
     deque_assert_ownership(w, pn);
-    CILK_ASSERT(w, cl->owner_ready_deque == NO_WORKER);
+    CILK_ASSERT(w, Closure_owner_deque(cl) == NO_WORKER);
 
-    cl->prev_ready = w->g->deques[pn].bottom;
+    cl->prev_ready = get_bottom(d);
     cl->next_ready = (Closure *)NULL;
-    w->g->deques[pn].bottom = cl;
-    WHEN_CILK_DEBUG(cl->owner_ready_deque = pn);
+    set_bottom(d, cl);
+    Closure_set_owner_deque(cl, pn);
 
-    if (w->g->deques[pn].top) {
+    if (get_top(d)) {
         CILK_ASSERT(w, cl->prev_ready);
         (cl->prev_ready)->next_ready = cl;
     } else {
-        w->g->deques[pn].top = cl;
+        set_top(d, cl);
     }
 }
+
+void deque_add_bottom_self(__cilkrts_worker *const w, Closure *cl) {
+    ReadyDeque *d = &w->g->deques[w->self];
+    if (get_bottom(d) != NULL) {
+        deque_lock_self(w);
+        deque_add_bottom(w, cl, w->self);
+        deque_unlock_self(w);
+        return;
+    }
+
+    CILK_ASSERT(w, Closure_owner_deque(cl) == NO_WORKER);
+    cl->prev_ready = (Closure *)NULL;
+    cl->next_ready = (Closure *)NULL;
+    Closure_set_owner_deque(cl, w->self);
+    set_bottom(d, cl);
+    // Thieves look at an empty deque only through deque_peek_top.  Setting
+    // top last, with release order, makes the rest visible to a thief that
+    // sees cl.
+    atomic_store_explicit(&d->top, cl, memory_order_release);
+}
+
+/*
+ * The stash is a list through next_ready and prev_ready, which stashed
+ * closures do not otherwise use because they are not in any deque.
+ */
+void deque_stash_push(__cilkrts_worker *const w, Closure *cl) {
+    ReadyDeque *d = &w->g->deques[w->self];
+    CILK_ASSERT(w, cl->status == CLOSURE_READY);
+
+    deque_lock_self(w);
+    cl->prev_ready = d->stash_bottom;
+    cl->next_ready = (Closure *)NULL;
+    if (d->stash_bottom)
+        d->stash_bottom->next_ready = cl;
+    else
+        d->stash_top = cl;
+    d->stash_bottom = cl;
+    atomic_store_explicit(&d->nstash, deque_stash_size(d) + 1,
+                          memory_order_relaxed);
+    deque_unlock_self(w);
+}
+
+static Closure *stash_unlink(ReadyDeque *d, Closure *cl) {
+    if (cl->prev_ready)
+        cl->prev_ready->next_ready = cl->next_ready;
+    else
+        d->stash_top = cl->next_ready;
+    if (cl->next_ready)
+        cl->next_ready->prev_ready = cl->prev_ready;
+    else
+        d->stash_bottom = cl->prev_ready;
+    cl->prev_ready = cl->next_ready = (Closure *)NULL;
+    atomic_store_explicit(&d->nstash, deque_stash_size(d) - 1,
+                          memory_order_relaxed);
+    return cl;
+}
+
+Closure *deque_stash_xtract_bottom_self(__cilkrts_worker *const w) {
+    ReadyDeque *d = &w->g->deques[w->self];
+    // Only the owner adds to its stash.
+    if (deque_stash_size(d) == 0)
+        return NULL;
+
+    deque_lock_self(w);
+    Closure *cl = d->stash_bottom;
+    if (cl)
+        stash_unlink(d, cl);
+    deque_unlock_self(w);
+    return cl;
+}
+
+Closure *deque_stash_xtract_top(__cilkrts_worker *const w, worker_id pn) {
+    ReadyDeque *d = &w->g->deques[pn];
+    deque_assert_ownership(w, pn);
+
+    Closure *cl = d->stash_top;
+    if (cl)
+        stash_unlink(d, cl);
+    return cl;
+}
@@ -4,6 +4,8 @@
 #include "closure.h"
 #include "rts-config.h"
 
+#include <stdatomic.h>
+
 // Forward declaration
 typedef struct ReadyDeque ReadyDeque;
 
@@ -14,8 +16,13 @@ typedef struct ReadyDeque ReadyDeque;
 // Actual declaration
 struct ReadyDeque {
     cilk_mutex mutex;
-    Closure *top, *bottom;
+    _Atomic(Closure *) top, bottom;
     worker_id mutex_owner;
+    // Ready closures that the owner stole in a batch but has not started
+    // yet; see options.steal_batch.  The owner takes them from the bottom
+    // and thieves from the top, under the lock.
+    Closure *stash_top, *stash_bottom;
+    atomic_uint nstash;
 } __attribute__((aligned(CILK_CACHE_LINE)));
 
 // assert that pn's deque be locked by ourselves
@@ -45,6 +52,14 @@ Closure *deque_xtract_bottom(__cilkrts_worker *const w, worker_id pn);
 CHEETAH_INTERNAL
 Closure *deque_peek_bottom(__cilkrts_worker *const w, worker_id pn);
 
+/*
+ * Remove the bottom of w -> self's own deque.  Unlike the functions above,
+ * the caller must not hold the lock, which is only taken if the deque is not
+ * empty.
+ */
+CHEETAH_INTERNAL
+Closure *deque_xtract_bottom_self(__cilkrts_worker *const w);
+
 /*
  * ANGE: this allow w -> self to append Closure cl onto worker pn's ready
  *       deque (i.e. make cl the new bottom).
@@ -52,6 +67,29 @@ Closure *deque_peek_bottom(__cilkrts_worker *const w, worker_id pn);
 CHEETAH_INTERNAL void deque_add_bottom(__cilkrts_worker *const w, Closure *cl,
                                        worker_id pn);
 
+/*
+ * Append cl onto w -> self's own deque without holding the lock.  The lock is
+ * only taken if the deque is not empty.
+ */
+CHEETAH_INTERNAL void deque_add_bottom_self(__cilkrts_worker *const w,
+                                            Closure *cl);
+
 CHEETAH_INTERNAL void deque_assert_is_bottom(__cilkrts_worker *const w,
                                              Closure *t);
+
+/*
+ * Ready closures stolen in a batch wait in the stash of the thief's deque.
+ * deque_stash_push and deque_stash_xtract_bottom_self take w -> self's own
+ * lock; deque_stash_xtract_top requires the lock on pn's deque, like the
+ * functions above.
+ */
+CHEETAH_INTERNAL void deque_stash_push(__cilkrts_worker *const w, Closure *cl);
+CHEETAH_INTERNAL Closure *
+deque_stash_xtract_bottom_self(__cilkrts_worker *const w);
+CHEETAH_INTERNAL Closure *deque_stash_xtract_top(__cilkrts_worker *const w,
+                                                 worker_id pn);
+
+static inline unsigned int deque_stash_size(ReadyDeque *d) {
+    return atomic_load_explicit(&d->nstash, memory_order_relaxed);
+}
 #endif
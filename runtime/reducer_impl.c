@@ -7,6 +7,7 @@
 #include "global.h"
 #include "init.h"
 #include "internal-malloc.h"
+#include "local.h"
 #include "mutex.h"
 #include "scheduler.h"
 #include <assert.h>
@@ -213,8 +214,9 @@ void __cilkrts_hyper_destroy(__cilkrts_hyperobject_base *key) {
 
     __cilkrts_worker *w = __cilkrts_get_tls_worker();
     // If we don't have a worker, use instead the last exiting worker from the
-    // default CilkRTS.
-    if (!w)
+    // default CilkRTS.  Workers of a multi-root runtime keep no reducer map
+    // between regions.
+    if (!w && !my_cilkrts->options.max_roots)
         w = my_cilkrts->workers[my_cilkrts->exiting_worker];
 
     hyper_id_t id = key->__id_num;
@@ -254,7 +256,8 @@ void __cilkrts_hyper_create(__cilkrts_hyperobject_base *key) {
         // Use the ID manager of the last exiting worker from the default
         // CilkRTS.
         m = my_cilkrts->id_manager;
-        w = my_cilkrts->workers[my_cilkrts->exiting_worker];
+        if (!my_cilkrts->options.max_roots)
+            w = my_cilkrts->workers[my_cilkrts->exiting_worker];
     } else {
         m = w->g->id_manager;
     }
@@ -268,10 +271,13 @@ void __cilkrts_hyper_create(__cilkrts_hyperobject_base *key) {
         if (id >= GLOBAL_REDUCER_LIMIT) {
             cilkrts_bug(w, "Global reducer pool exhausted");
         }
+        // Other threads may be creating reducers in a multi-root runtime.
+        reducer_id_manager_lock(m, w);
         if (!m->global) {
             m->global = calloc(GLOBAL_REDUCER_LIMIT, sizeof *m->global);
         }
         m->global[id] = key;
+        reducer_id_manager_unlock(m, w);
         return;
     }
 
@@ -350,10 +356,15 @@ void *__cilkrts_hyper_lookup(__cilkrts_hyperobject_base *key) {
 void *__cilkrts_hyper_alloc(__cilkrts_hyperobject_base *key, size_t bytes) {
     if (USE_INTERNAL_MALLOC) {
         __cilkrts_worker *w = __cilkrts_get_tls_worker();
-        if (!w)
+        if (!w) {
+            // Another thread may be using every worker of a multi-root
+            // runtime.
+            if (my_cilkrts->options.max_roots)
+                return cilk_aligned_alloc(16, bytes);
             // Use instead the worker from the default CilkRTS that last exited
             // a Cilkified region
             w = my_cilkrts->workers[my_cilkrts->exiting_worker];
+        }
         return cilk_internal_malloc(w, bytes, IM_REDUCER_MAP);
     } else
         return cilk_aligned_alloc(16, bytes);
@@ -362,10 +373,15 @@ void *__cilkrts_hyper_alloc(__cilkrts_hyperobject_base *key, size_t bytes) {
 void __cilkrts_hyper_dealloc(__cilkrts_hyperobject_base *key, void *view) {
     if (USE_INTERNAL_MALLOC) {
         __cilkrts_worker *w = __cilkrts_get_tls_worker();
-        if (!w)
+        if (!w) {
+            if (my_cilkrts->options.max_roots) {
+                free(view);
+                return;
+            }
             // Use instead the worker from the default CilkRTS that last exited
             // a Cilkified region
             w = my_cilkrts->workers[my_cilkrts->exiting_worker];
+        }
         cilk_internal_free(w, view, key->__view_size, IM_REDUCER_MAP);
     } else
         free(view);
@@ -375,6 +391,17 @@ void __cilkrts_hyper_dealloc(__cilkrts_hyperobject_base *key, void *view) {
 // Helper function for the scheduler
 // =================================================================
 
+// Reduce the views in w's reducer map into the leftmost views and destroy the
+// map.  Called when w finishes a root of a multi-root runtime, where reducers
+// have no views outside Cilkified regions.
+void reducers_reduce_into_leftmost(__cilkrts_worker *w) {
+    cilkred_map *h = w->reducer_map;
+    if (h) {
+        w->reducer_map = NULL;
+        cilkred_map_reduce_into_leftmost(h, w);
+    }
+}
+
 #if DL_INTERPOSE
 #define START_DL_INTERPOSABLE(func, type)                               \
     if (__builtin_expect(dl_##func == NULL, false)) {                   \
@@ -412,6 +439,7 @@ cilkred_map *__cilkrts_internal_merge_two_rmaps(__cilkrts_worker *const ws,
         return right;
     if (!right)
         return left;
+    CILK_COUNT(ws, COUNTER_REDUCER_MERGE);
 
     /* Special case, if left is leftmost, then always merge into it.
        For C reducers this forces lazy creation of the leftmost views. */
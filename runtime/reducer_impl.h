@@ -16,6 +16,7 @@
 CHEETAH_INTERNAL void reducers_init(global_state *);
 CHEETAH_INTERNAL void reducers_import(global_state *, __cilkrts_worker *);
 CHEETAH_INTERNAL void reducers_deinit(global_state *);
+CHEETAH_INTERNAL void reducers_reduce_into_leftmost(__cilkrts_worker *);
 
 // used by the scheduler
 #if DL_INTERPOSE
@@ -0,0 +1,157 @@
+// Roots of Cilkified regions.
+//
+// A runtime normally runs one Cilkified region at a time: the Cilkifying
+// thread hands g->root_closure to the workers and sleeps until the region is
+// done.  With options.max_roots set (CILK_MAX_ROOTS, or
+// cilk_thrd_init_shared), the workers instead stay in the work-stealing loop
+// and any number of attached threads submit roots to them:
+//
+//   - A Cilkifying thread takes a root from g->free_roots, prepares its
+//     closure as for a single-root region, and appends it to g->ready_roots.
+//   - Workers check g->ready_roots before each steal attempt and start a
+//     root closure like any stolen closure.  Parked workers are woken when a
+//     root is submitted.
+//   - The worker that finishes a region reduces its reducer views into the
+//     leftmost views, records itself as the root's exiting worker, and
+//     returns to the scheduler.  Once off the root's fiber, it marks the root
+//     done and wakes the Cilkifying thread, which returns the root to
+//     g->free_roots.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "cilk-internal.h"
+#include "closure.h"
+#include "debug.h"
+#include "fiber.h"
+#include "global.h"
+#include "park.h"
+#include "roots.h"
+
+void roots_init(global_state *g, __cilkrts_worker *w) {
+    unsigned int n = g->options.max_roots ? g->options.max_roots : 1;
+    cilkrts_alert(BOOT, w, "(roots_init) %u roots", n);
+
+    pthread_mutex_init(&g->roots_lock, NULL);
+    pthread_cond_init(&g->roots_cond_var, NULL);
+    g->roots = (struct cilk_root *)calloc(n, sizeof(struct cilk_root));
+    g->free_roots = NULL;
+    g->ready_roots = g->ready_roots_tail = NULL;
+
+    for (unsigned int i = n; i-- > 0;) {
+        struct cilk_root *root = &g->roots[i];
+        // Create the root closure and a fiber to go with it.
+        root->closure = Closure_create(w);
+        root->closure->fiber = cilk_fiber_allocate(w, g->options.stacksize);
+        root->closure->root = root;
+        root->initialized = false;
+        root->exiting_worker = NO_WORKER;
+        atomic_store_explicit(&root->cilkified, 0, memory_order_relaxed);
+        atomic_store_explicit(&root->sleeping, 0, memory_order_relaxed);
+        pthread_mutex_init(&root->lock, NULL);
+        pthread_cond_init(&root->cond_var, NULL);
+        root->next = g->free_roots;
+        g->free_roots = root;
+    }
+    g->root_closure = g->roots[0].closure;
+}
+
+void roots_deinit(global_state *g) {
+    unsigned int n = g->options.max_roots ? g->options.max_roots : 1;
+    for (unsigned int i = 0; i < n; ++i) {
+        struct cilk_root *root = &g->roots[i];
+        CILK_ASSERT_G(!atomic_load_explicit(&root->cilkified,
+                                            memory_order_relaxed));
+        // Deallocate the root closure and its fiber
+        cilk_fiber_deallocate_global(g, root->closure->fiber);
+        Closure_destroy_global(g, root->closure);
+        pthread_mutex_destroy(&root->lock);
+        pthread_cond_destroy(&root->cond_var);
+    }
+    free(g->roots);
+    g->roots = NULL;
+    g->root_closure = NULL;
+    pthread_mutex_destroy(&g->roots_lock);
+    pthread_cond_destroy(&g->roots_cond_var);
+}
+
+struct cilk_root *root_acquire(global_state *g) {
+    pthread_mutex_lock(&g->roots_lock);
+    while (!g->free_roots)
+        pthread_cond_wait(&g->roots_cond_var, &g->roots_lock);
+    struct cilk_root *root = g->free_roots;
+    g->free_roots = root->next;
+    pthread_mutex_unlock(&g->roots_lock);
+    root->next = NULL;
+    return root;
+}
+
+void root_release(global_state *g, struct cilk_root *root) {
+    CILK_ASSERT_G(!atomic_load_explicit(&root->cilkified,
+                                        memory_order_relaxed));
+    pthread_mutex_lock(&g->roots_lock);
+    root->next = g->free_roots;
+    g->free_roots = root;
+    pthread_cond_signal(&g->roots_cond_var);
+    pthread_mutex_unlock(&g->roots_lock);
+}
+
+void root_submit(global_state *g, struct cilk_root *root) {
+    atomic_store_explicit(&root->cilkified, 1, memory_order_release);
+
+    pthread_mutex_lock(&g->roots_lock);
+    root->next = NULL;
+    if (g->ready_roots_tail)
+        g->ready_roots_tail->next = root;
+    else
+        g->ready_roots = root;
+    g->ready_roots_tail = root;
+    atomic_fetch_add_explicit(&g->nready_roots, 1, memory_order_seq_cst);
+    pthread_mutex_unlock(&g->roots_lock);
+
+    // worker_park checks nready_roots before sleeping.
+    worker_wake_any(g);
+}
+
+Closure *root_dequeue(__cilkrts_worker *w) {
+    global_state *g = w->g;
+    pthread_mutex_lock(&g->roots_lock);
+    struct cilk_root *root = g->ready_roots;
+    if (root) {
+        g->ready_roots = root->next;
+        if (!g->ready_roots)
+            g->ready_roots_tail = NULL;
+        root->next = NULL;
+        atomic_fetch_sub_explicit(&g->nready_roots, 1, memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&g->roots_lock);
+    if (!root)
+        return NULL;
+    cilkrts_alert(SCHED, w, "(root_dequeue) root closure %p",
+                  (void *)root->closure);
+    return root->closure;
+}
+
+void root_complete(struct cilk_root *root) {
+    atomic_store_explicit(&root->cilkified, 0, memory_order_seq_cst);
+    // The root may already be running another region, in which case a
+    // spurious signal does no harm.
+    if (atomic_load_explicit(&root->sleeping, memory_order_seq_cst)) {
+        pthread_mutex_lock(&root->lock);
+        pthread_cond_signal(&root->cond_var);
+        pthread_mutex_unlock(&root->lock);
+    }
+}
+
+void root_wait(global_state *g, struct cilk_root *root) {
+    if (spin_on_flag(&root->cilkified, false, g->options.handoff_spin))
+        return;
+    pthread_mutex_lock(&root->lock);
+    atomic_store_explicit(&root->sleeping, 1, memory_order_seq_cst);
+    while (atomic_load_explicit(&root->cilkified, memory_order_seq_cst)) {
+        pthread_cond_wait(&root->cond_var, &root->lock);
+    }
+    atomic_store_explicit(&root->sleeping, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&root->lock);
+}
@@ -0,0 +1,55 @@
+#ifndef _CILK_ROOTS_H
+#define _CILK_ROOTS_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "cilk-internal.h"
+#include "closure.h"
+#include "global.h"
+
+// A root holds the outermost closure of a Cilkified region and the state
+// needed to return to the thread that Cilkified it.  A runtime has a single
+// root, unless options.max_roots is set, in which case it has that many and
+// as many threads may run Cilkified regions on its workers at once.
+struct cilk_root {
+    Closure *closure;         // with the fiber that the region runs on
+    bool initialized;         // the region's first frame has been resumed
+    worker_id exiting_worker; // the worker that finished the last region
+    atomic_bool cilkified;    // a region is running on this root
+    atomic_bool sleeping;     // the Cilkifying thread is blocked on cond_var
+    pthread_mutex_t lock;
+    pthread_cond_t cond_var;
+    struct cilk_root *next;   // in g->free_roots or g->ready_roots
+};
+
+// Create the roots of g, allocating from worker w.
+CHEETAH_INTERNAL void roots_init(global_state *g, __cilkrts_worker *w);
+CHEETAH_INTERNAL void roots_deinit(global_state *g);
+
+// The rest is only used by multi-root runtimes.
+
+// Take a free root, waiting for one if all are running regions.
+CHEETAH_INTERNAL struct cilk_root *root_acquire(global_state *g);
+CHEETAH_INTERNAL void root_release(global_state *g, struct cilk_root *root);
+
+// Queue the ready closure of root for a worker to start.
+CHEETAH_INTERNAL void root_submit(global_state *g, struct cilk_root *root);
+CHEETAH_INTERNAL Closure *root_dequeue(__cilkrts_worker *w);
+
+// Take a submitted root closure to execute, if there is one.
+static inline Closure *root_take(__cilkrts_worker *w) {
+    if (atomic_load_explicit(&w->g->nready_roots, memory_order_relaxed) == 0)
+        return NULL;
+    return root_dequeue(w);
+}
+
+// Mark the region on root as done, once the worker that finished it is off
+// the root's fiber, and wake its Cilkifying thread.
+CHEETAH_INTERNAL void root_complete(struct cilk_root *root);
+
+// Wait for the region on root to be done.  Executed by the Cilkifying thread.
+CHEETAH_INTERNAL void root_wait(global_state *g, struct cilk_root *root);
+
+#endif /* _CILK_ROOTS_H */
@@ -27,6 +27,24 @@
 
 #define CILK_CACHE_LINE 64
 
+/* Lock implementations for cilk_mutex, which guards closures, deques, and
+   shared pools.  MUTEX_PTHREAD is a pthread spinlock (a pthread mutex on
+   Apple).  MUTEX_TICKET grants the lock in arrival order.  MUTEX_MCS queues
+   waiters so that each spins on its own cache line.  MUTEX_FUTEX spins
+   briefly and then sleeps in the kernel.  With CILK_MUTEX_STATS each lock
+   also counts its acquisitions, contended acquisitions, and time spent
+   waiting, which CILK_ALERT=0x8000 prints at shutdown. */
+#define MUTEX_PTHREAD 0
+#define MUTEX_TICKET 1
+#define MUTEX_MCS 2
+#define MUTEX_FUTEX 3
+#ifndef CILK_MUTEX_IMPL
+#define CILK_MUTEX_IMPL MUTEX_PTHREAD
+#endif
+#ifndef CILK_MUTEX_STATS
+#define CILK_MUTEX_STATS 0
+#endif
+
 #define PROC_SPEED_IN_GHZ 2.2
 
 #if defined __linux__
@@ -46,11 +64,37 @@
 #define MAX_STACK_ALIGN 64
 
 #define DEFAULT_NPROC 0 // 0 for # of cores available
-#define DEFAULT_DEQ_DEPTH 1024
+#define DEFAULT_DEQ_DEPTH 64 // initial size; grows on demand
 #define DEFAULT_STACK_SIZE 0x100000 // 1 MBytes
 #define DEFAULT_FIBER_POOL_CAP 128  // initial per-worker fiber pool capacity
+#define DEFAULT_FIBER_POOL_ADAPT 1  // resize per-worker fiber pools between regions
+#define DEFAULT_STACK_RESERVE ((size_t)-1) // bytes of a pooled stack kept resident
+#define DEFAULT_STACK_ARENA 1  // carve fiber stacks out of large mappings
+#define DEFAULT_FIBER_PREWARM 0 // fibers per worker pool filled at startup
+#define DEFAULT_FIBER_PREWARM_GLOBAL 0 // fibers of the global pool filled at startup
+#define DEFAULT_STACK_PREFAULT 0 // bytes of each prewarmed stack faulted in
 #define DEFAULT_REDUCER_LIMIT 1024
 #define DEFAULT_FORCE_REDUCE 0 // do not self steal to force reduce
+#define DEFAULT_BOSS_WORKER 0  // the Cilkifying thread blocks during a region
+#define DEFAULT_HANDOFF_SPIN 0 // microseconds to spin before blocking between regions
+#define DEFAULT_MAX_ROOTS 0    // 0 for one Cilkified region at a time
+#define DEFAULT_STEAL_BATCH 1  // closures taken from a victim per steal
+#define DEFAULT_STEAL_POLICY STEAL_POLICY_UNIFORM // see enum steal_policy
+#define DEFAULT_SERIAL 1       // run a one-worker runtime without stealing
+#define DEFAULT_LEAPFROG 0     // steal from a failed sync's children first
+/* Percent of steal attempts that look no farther than the same core, the
+   same last-level cache, and the same socket.  The rest may go anywhere. */
+#define DEFAULT_STEAL_CORE_PCT 20
+#define DEFAULT_STEAL_CACHE_PCT 30
+#define DEFAULT_STEAL_SOCKET_PCT 30
+
+/* Workers running children of a failed sync that its worker remembers for
+   leapfrogging. */
+#define CILK_LEAPFROG_VICTIMS 8
+
+/* Idle thieves are counted per socket, in up to this many counters, for
+   __cilkrts_is_anyone_hungry. */
+#define CILK_IDLE_GROUPS 8
 
 #define MAX_CALLBACKS 32 // Maximum number of init or exit callbacks
 #endif                   // _CONFIG_H
@@ -1,9 +1,12 @@
+#include <inttypes.h>
 #include <stdio.h>
 
 #include "cilk-internal.h"
 #include "debug.h"
 #include "internal-malloc-impl.h"
 #include "local.h"
+#include "global.h"
+#include "readydeque.h"
 #include "sched_stats.h"
 
 #if SCHED_STATS
@@ -142,3 +145,174 @@ void cilk_reset_timing() {
 }
 */
 #endif
+
+static const char *counter_to_str(enum counter_type t) {
+    switch (t) {
+    case COUNTER_STEAL_ATTEMPT:
+        return "steal attempts";
+    case COUNTER_STEAL:
+        return "steals";
+    case COUNTER_STEAL_BATCHED:
+        return "batched steals";
+    case COUNTER_STEAL_LEAPFROG:
+        return "leapfrogs";
+    case COUNTER_STEAL_EMPTY:
+        return "empty";
+    case COUNTER_STEAL_LOCKED:
+        return "locked";
+    case COUNTER_STEAL_RETURNING:
+        return "returning";
+    case COUNTER_STEAL_DEKKER:
+        return "dekker";
+    case COUNTER_PROVABLY_GOOD:
+        return "provably good";
+    case COUNTER_SYNC_FAILED:
+        return "failed syncs";
+    case COUNTER_FIBER_ALLOC:
+        return "fibers";
+    case COUNTER_POOL_GLOBAL:
+        return "global pool";
+    case COUNTER_POOL_RETRY:
+        return "pool retries";
+    case COUNTER_REDUCER_MERGE:
+        return "merges";
+    case COUNTER_PARK:
+        return "parks";
+    case COUNTER_PARK_NS:
+        return "parked (ms)";
+    case COUNTER_WAKE:
+        return "wakes";
+    case COUNTER_LENT_NS:
+        return "lent (ms)";
+    default:
+        return "unknown";
+    }
+}
+
+// Counters measured in nanoseconds are printed in milliseconds.
+static uint64_t counter_value(enum counter_type t, uint64_t v) {
+    return (t == COUNTER_PARK_NS || t == COUNTER_LENT_NS) ? v / 1000000 : v;
+}
+
+#if CILK_MUTEX_STATS
+static void mutex_stats_print_row(const char *name, unsigned int i,
+                                  const struct cilk_mutex_stats *d,
+                                  const struct cilk_mutex_stats *c) {
+    fprintf(stderr, "%10s %3u:", name, i);
+    fprintf(stderr, "%15" PRIu64 "%15" PRIu64 "%15" PRIu64, d->acquire,
+            d->contended, d->wait);
+    fprintf(stderr, "%15" PRIu64 "%15" PRIu64 "%15" PRIu64 "\n", c->acquire,
+            c->contended, c->wait);
+}
+
+// Deque locks are reported for the deque's owner, and closure locks for the
+// worker that destroyed the closure.
+static void cilk_mutex_stats_print(struct global_state *g) {
+    struct cilk_mutex_stats dtotal = {0}, ctotal = {0}, other = {0};
+
+    fprintf(stderr, "\nLOCK COUNTERS:\n%15s", "");
+    fprintf(stderr, "%15s%15s%15s", "deque acquire", "deque contend",
+            "deque wait");
+    fprintf(stderr, "%15s%15s%15s\n", "closure acq", "closure contend",
+            "closure wait");
+    for (unsigned int i = 0; i < g->nworkers; i++) {
+        __cilkrts_worker *w = g->workers[i];
+        struct cilk_mutex_stats d = {0};
+        cilk_mutex_stats_add(&d, &g->deques[i].mutex);
+        cilk_mutex_stats_add(&dtotal, &g->deques[i].mutex);
+        ctotal.acquire += w->l->closure_lock_stats.acquire;
+        ctotal.contended += w->l->closure_lock_stats.contended;
+        ctotal.wait += w->l->closure_lock_stats.wait;
+        mutex_stats_print_row("Worker", w->self, &d,
+                              &w->l->closure_lock_stats);
+    }
+    fprintf(stderr, "%15s", "Total:");
+    fprintf(stderr, "%15" PRIu64 "%15" PRIu64 "%15" PRIu64, dtotal.acquire,
+            dtotal.contended, dtotal.wait);
+    fprintf(stderr, "%15" PRIu64 "%15" PRIu64 "%15" PRIu64 "\n",
+            ctotal.acquire, ctotal.contended, ctotal.wait);
+
+    cilk_mutex_stats_add(&other, &g->im_lock);
+    fprintf(stderr,
+            "Global memory pool: %" PRIu64 " acquired, %" PRIu64
+            " contended, %" PRIu64 " waiting\n",
+            other.acquire, other.contended, other.wait);
+}
+#endif
+
+static void sched_counters_sum(struct global_state *g,
+                               uint64_t total[NUMBER_OF_COUNTERS]) {
+    for (int t = 0; t < NUMBER_OF_COUNTERS; t++)
+        total[t] = 0;
+    for (unsigned int i = 0; i < g->nworkers; i++) {
+        __cilkrts_worker *w = g->workers[i];
+        for (int t = 0; t < NUMBER_OF_COUNTERS; t++)
+            total[t] += atomic_load_explicit(&w->l->counters.count[t],
+                                             memory_order_relaxed);
+    }
+}
+
+// The counters are never reset, because only their owners may write them.
+// Instead the runtime remembers the totals it last reported, and reports
+// the difference.
+void cilk_thrd_take_stats(cilk_runtime_t g, cilk_runtime_stats_t *stats) {
+    uint64_t total[NUMBER_OF_COUNTERS], d[NUMBER_OF_COUNTERS];
+
+    cilk_mutex_lock(&g->counters_lock);
+    sched_counters_sum(g, total);
+    for (int t = 0; t < NUMBER_OF_COUNTERS; t++) {
+        d[t] = total[t] - g->counters_taken[t];
+        g->counters_taken[t] = total[t];
+    }
+    cilk_mutex_unlock(&g->counters_lock);
+
+    stats->steal_attempts = d[COUNTER_STEAL_ATTEMPT];
+    stats->steals = d[COUNTER_STEAL];
+    stats->steal_fail_empty = d[COUNTER_STEAL_EMPTY];
+    stats->steal_fail_locked = d[COUNTER_STEAL_LOCKED];
+    stats->steal_fail_returning = d[COUNTER_STEAL_RETURNING];
+    stats->steal_fail_dekker = d[COUNTER_STEAL_DEKKER];
+    stats->provably_good_steals = d[COUNTER_PROVABLY_GOOD];
+    stats->failed_syncs = d[COUNTER_SYNC_FAILED];
+    stats->fibers_allocated = d[COUNTER_FIBER_ALLOC];
+    stats->global_pool_batches = d[COUNTER_POOL_GLOBAL];
+    stats->global_pool_retries = d[COUNTER_POOL_RETRY];
+    stats->reducer_merges = d[COUNTER_REDUCER_MERGE];
+}
+
+void cilk_sched_counters_print(struct global_state *g) {
+#define COUNTER_HDR_DESC "%15s"
+#define COUNTER_WORKER_HDR_DESC "%10s %3u:"
+#define COUNTER_FIELD_DESC "%15" PRIu64
+
+    uint64_t total[NUMBER_OF_COUNTERS] = {0};
+
+    fprintf(stderr, "\nSCHEDULER COUNTERS:\n");
+    fprintf(stderr, COUNTER_HDR_DESC, "");
+    for (int t = 0; t < NUMBER_OF_COUNTERS; t++) {
+        fprintf(stderr, COUNTER_HDR_DESC, counter_to_str(t));
+    }
+    fprintf(stderr, "\n");
+
+    for (unsigned int i = 0; i < g->nworkers; i++) {
+        __cilkrts_worker *w = g->workers[i];
+        fprintf(stderr, COUNTER_WORKER_HDR_DESC, "Worker", w->self);
+        for (int t = 0; t < NUMBER_OF_COUNTERS; t++) {
+            uint64_t v = atomic_load_explicit(&w->l->counters.count[t],
+                                              memory_order_relaxed);
+            total[t] += v;
+            fprintf(stderr, COUNTER_FIELD_DESC, counter_value(t, v));
+        }
+        fprintf(stderr, "\n");
+    }
+
+    fprintf(stderr, COUNTER_HDR_DESC, "Total:");
+    for (int t = 0; t < NUMBER_OF_COUNTERS; t++) {
+        fprintf(stderr, COUNTER_FIELD_DESC, counter_value(t, total[t]));
+    }
+    fprintf(stderr, "\n");
+
+#if CILK_MUTEX_STATS
+    cilk_mutex_stats_print(g);
+#endif
+}
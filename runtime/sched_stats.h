@@ -2,6 +2,7 @@
 #define __SCHED_STATS_HEADER__
 
 #include "rts-config.h"
+#include <stdatomic.h>
 #include <stdint.h>
 
 typedef struct __cilkrts_worker __cilkrts_worker;
@@ -25,6 +26,49 @@ struct global_sched_stats {
     double time[NUMBER_OF_STATS]; // Total time measured for all stats
 };
 
+// Event counters, maintained whether or not SCHED_STATS is enabled.
+enum counter_type {
+    COUNTER_STEAL_ATTEMPT = 0, // calls to Closure_steal
+    COUNTER_STEAL,             // successful steals
+    COUNTER_STEAL_BATCHED,     // steals beyond the first of a batch
+    COUNTER_STEAL_LEAPFROG,    // steals from workers running children
+    COUNTER_STEAL_EMPTY,       // failed steals: nothing on the deque
+    COUNTER_STEAL_LOCKED,      // failed steals: a lock was taken
+    COUNTER_STEAL_RETURNING,   // failed steals: the closure was returning
+    COUNTER_STEAL_DEKKER,      // failed steals: the victim took the frame back
+    COUNTER_PROVABLY_GOOD,     // provably-good steals
+    COUNTER_SYNC_FAILED,       // syncs that suspended a closure
+    COUNTER_FIBER_ALLOC,       // fibers taken from the worker's pool
+    COUNTER_POOL_GLOBAL,       // batches moved to or from the global pool
+    COUNTER_POOL_RETRY,        // failed compare-and-swaps on the global pool
+    COUNTER_REDUCER_MERGE,     // merges of two reducer maps
+    COUNTER_PARK,              // times the worker parked in the steal loop
+    COUNTER_PARK_NS,           // nanoseconds spent parked
+    COUNTER_WAKE,              // parked workers woken by this worker
+    COUNTER_LENT_NS,           // nanoseconds spent lent to other runtimes
+    NUMBER_OF_COUNTERS         // must be the very last entry
+};
+
+// Only the owning worker updates its counters.  The counters are atomic so
+// that other threads may read them while the worker runs.
+struct sched_counters {
+    _Atomic uint64_t count[NUMBER_OF_COUNTERS];
+};
+
+static inline void cilk_counter_add(struct sched_counters *c,
+                                    enum counter_type t, uint64_t n) {
+    atomic_store_explicit(
+        &c->count[t],
+        atomic_load_explicit(&c->count[t], memory_order_relaxed) + n,
+        memory_order_relaxed);
+}
+
+#define CILK_COUNT(w, t) cilk_counter_add(&(w)->l->counters, t, 1)
+#define CILK_COUNT_N(w, t, n) cilk_counter_add(&(w)->l->counters, t, n)
+
+CHEETAH_INTERNAL
+void cilk_sched_counters_print(struct global_state *g);
+
 #if SCHED_STATS
 CHEETAH_INTERNAL
 void cilk_global_sched_stats_init(struct global_sched_stats *s);
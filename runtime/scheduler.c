@@ -4,7 +4,8 @@
 #include <sched.h>
 #endif
 #include <stdio.h>
-#include <unistd.h> /* usleep */
+#include <stdlib.h>
+#include <string.h>
 #include <unwind.h>
 
 #include "cilk-internal.h"
@@ -13,8 +14,12 @@
 #include "global.h"
 #include "jmpbuf.h"
 #include "local.h"
+#include "loop.h"
+#include "park.h"
 #include "readydeque.h"
+#include "roots.h"
 #include "scheduler.h"
+#include "topology.h"
 
 #include "reducer_impl.h"
 
@@ -36,6 +41,112 @@ static void rts_srand(__cilkrts_worker *const w, unsigned int seed) {
     w->l->rand_next = seed;
 }
 
+// How much work a thief could take from victim: the frames between head and
+// tail, and the closures in its stash.  The reads are racy and only a hint.
+static inline long victim_work(global_state *const g, unsigned int victim) {
+    __cilkrts_worker *victim_w = g->workers[victim];
+    __cilkrts_stack_frame **head =
+        atomic_load_explicit(&victim_w->head, memory_order_relaxed);
+    __cilkrts_stack_frame **tail =
+        atomic_load_explicit(&victim_w->tail, memory_order_relaxed);
+    long frames = tail - head;
+    return (frames > 0 ? frames : 0) + deque_stash_size(&g->deques[victim]);
+}
+
+// Choose a victim for w uniformly at random.  With topology information,
+// first choose how far away to look, using the probabilities in g->options,
+// and then choose uniformly among the workers no farther away than that.
+static unsigned int choose_victim_uniform(__cilkrts_worker *const w) {
+    const struct victim_list *vl = &w->l->victims;
+    if (!vl->victims)
+        return rts_rand(w) % w->g->nworkers;
+
+    const struct rts_options *opt = &w->g->options;
+    unsigned int pct = rts_rand(w) % 100;
+    int level;
+    if (pct < opt->steal_core_pct) {
+        level = VICTIM_CORE;
+    } else if ((pct -= opt->steal_core_pct) < opt->steal_cache_pct) {
+        level = VICTIM_CACHE;
+    } else if ((pct -= opt->steal_cache_pct) < opt->steal_socket_pct) {
+        level = VICTIM_SOCKET;
+    } else {
+        level = VICTIM_REMOTE;
+    }
+    // If no worker is that close, look farther.  There is at least one
+    // victim at VICTIM_REMOTE or nearer.
+    while (vl->end[level] == 0)
+        ++level;
+    return vl->victims[rts_rand(w) % vl->end[level]];
+}
+
+// Choose a victim for w to steal from, using options.steal_policy.  After the
+// attempt, the scheduler reports the outcome with victim_steal_result.
+static unsigned int choose_victim(__cilkrts_worker *const w) {
+    global_state *const g = w->g;
+    // After a failed sync, try the workers running its children first.
+    if (w->l->nleapfrog)
+        return w->l->leapfrog[w->l->nleapfrog - 1];
+    switch (g->options.steal_policy) {
+    case STEAL_POLICY_LAST_VICTIM: {
+        // Go back to the last victim that w stole from, as long as it
+        // appears to have more work.
+        worker_id last = w->l->last_victim;
+        if (last != NO_WORKER && last < g->nworkers &&
+            victim_work(g, last) > 0)
+            return last;
+        return choose_victim_uniform(w);
+    }
+    case STEAL_POLICY_POWER_OF_TWO: {
+        // Pick the one with more work of two random victims.
+        unsigned int a = choose_victim_uniform(w);
+        unsigned int b = choose_victim_uniform(w);
+        if (a == w->self)
+            return b;
+        if (b == w->self)
+            return a;
+        return victim_work(g, b) > victim_work(g, a) ? b : a;
+    }
+    default:
+        return choose_victim_uniform(w);
+    }
+}
+
+static void victim_steal_result(__cilkrts_worker *const w,
+                                unsigned int victim, bool success) {
+    if (success)
+        w->l->last_victim = victim;
+    else if (w->l->last_victim == victim)
+        w->l->last_victim = NO_WORKER;
+
+    // Keep going back to a worker running a child until it has nothing left
+    // to steal.
+    unsigned int n = w->l->nleapfrog;
+    if (n && w->l->leapfrog[n - 1] == victim) {
+        if (success)
+            CILK_COUNT(w, COUNTER_STEAL_LEAPFROG);
+        else
+            w->l->nleapfrog = n - 1;
+    }
+}
+
+// Leapfrogging: when w fails to sync t, remember the workers whose deques
+// hold t's outstanding children.  Stealing from them first takes work from
+// the subcomputations t is waiting for, which keeps w's working set near t's
+// and shortens the path to the sync.  The caller holds t's lock, so the
+// children cannot go away, but the deques holding them may change
+// concurrently.  A stale owner only costs w a failed steal.
+static void leapfrog_record(__cilkrts_worker *const w, Closure *t) {
+    unsigned int n = 0;
+    for (Closure *child = t->right_most_child;
+         child && n < CILK_LEAPFROG_VICTIMS; child = child->left_sib) {
+        worker_id owner = Closure_owner_deque(child);
+        if (owner != NO_WORKER && owner != w->self)
+            w->l->leapfrog[n++] = owner;
+    }
+    w->l->nleapfrog = n;
+}
+
 static void worker_change_state(__cilkrts_worker *w,
                                 enum __cilkrts_worker_state s) {
     /* TODO: Update statistics based on state change. */
@@ -75,7 +186,7 @@ static void decrement_exception_pointer(__cilkrts_worker *const w,
     Closure_assert_ownership(w, cl);
     // It's possible that this steal attempt peeked the root closure from the
     // top of a deque while a new Cilkified region was starting.
-    CILK_ASSERT(w, cl->status == CLOSURE_RUNNING || cl == w->g->root_closure);
+    CILK_ASSERT(w, cl->status == CLOSURE_RUNNING || cl->root);
     __cilkrts_stack_frame **exc =
         atomic_load_explicit(&victim_w->exc, memory_order_relaxed);
     if (exc != EXCEPTION_INFINITY) {
@@ -107,6 +218,66 @@ static void signal_immediate_exception_to_all(__cilkrts_worker *const w) {
 }
 */
 
+/***********************************************************
+ * Growing the shadow stack
+ ***********************************************************/
+
+// The shadow stack starts with options.deqdepth entries and doubles whenever
+// a spawn finds it full.  Thieves only dereference a victim's head while
+// holding the victim's deque lock; their unlocked peeks at head and tail only
+// compare the two.  Holding our own deque lock while moving the entries and
+// rebasing head, tail and exc is therefore enough to keep thieves away from
+// the old array, and they only wait for the copy.
+__cilkrts_stack_frame **shadow_stack_alloc(size_t entries) {
+    size_t size = shadow_stack_bytes(entries);
+    __cilkrts_stack_frame **stack = (__cilkrts_stack_frame **)cilk_aligned_alloc(
+        (size_t)1 << cheetah_page_shift, size);
+    if (stack)
+        memset(stack, 0, size);
+    return stack;
+}
+
+__cilkrts_stack_frame **__cilkrts_grow_shadow_stack(__cilkrts_worker *w) {
+    local_state *l = w->l;
+    __cilkrts_stack_frame **old_stack = l->shadow_stack;
+    size_t old_size = w->ltq_limit - old_stack;
+    // Twice the entries in use, counting the one about to be pushed.  Only
+    // this worker moves its tail, so it is safe to read before locking.
+    size_t new_size =
+        2 * (atomic_load_explicit(&w->tail, memory_order_relaxed) -
+             old_stack + 1);
+    __cilkrts_stack_frame **new_stack = shadow_stack_alloc(new_size);
+    if (new_stack == NULL) {
+        cilkrts_bug(w, "Cannot grow shadow stack to %zu entries", new_size);
+    }
+    // The allocator may hand back pages first touched on another node.
+    topology_move_home(new_stack, shadow_stack_bytes(new_size));
+    cilkrts_alert(SCHED, w, "(grow_shadow_stack) %zu -> %zu entries", old_size,
+                  new_size);
+
+    deque_lock_self(w);
+    memcpy(new_stack, old_stack, old_size * sizeof(__cilkrts_stack_frame *));
+    __cilkrts_stack_frame **head =
+        atomic_load_explicit(&w->head, memory_order_relaxed);
+    __cilkrts_stack_frame **tail =
+        atomic_load_explicit(&w->tail, memory_order_relaxed);
+    __cilkrts_stack_frame **exc =
+        atomic_load_explicit(&w->exc, memory_order_relaxed);
+    head = new_stack + (head - old_stack);
+    tail = new_stack + (tail - old_stack);
+    if (exc != EXCEPTION_INFINITY)
+        exc = new_stack + (exc - old_stack);
+    atomic_store_explicit(&w->head, head, memory_order_relaxed);
+    atomic_store_explicit(&w->tail, tail, memory_order_relaxed);
+    atomic_store_explicit(&w->exc, exc, memory_order_relaxed);
+    l->shadow_stack = new_stack;
+    w->ltq_limit = new_stack + new_size;
+    deque_unlock_self(w);
+
+    free(old_stack);
+    return tail;
+}
+
 static void setup_for_execution(__cilkrts_worker *w, Closure *t) {
     cilkrts_alert(SCHED, w, "(setup_for_execution) closure %p", (void *)t);
     t->frame->worker = w;
@@ -175,8 +346,13 @@ void *__cilkrts_get_current_thread_id() { return (void *)pthread_self(); }
 
 __cilkrts_worker *__cilkrts_get_tls_worker() { return tls_worker; }
 
+// Points compiled code at the runtime's count of sockets with idle thieves;
+// see __cilkrts_is_anyone_hungry.
+__thread const int *__cilkrts_hungry_groups = NULL;
+
 CHEETAH_INTERNAL void __cilkrts_set_tls_worker(__cilkrts_worker *w) {
     tls_worker = w;
+    __cilkrts_hungry_groups = w ? (const int *)&w->g->hungry_groups : NULL;
 }
 
 // ==============================================
@@ -267,7 +443,7 @@ static Closure *unconditional_steal(__cilkrts_worker *const w,
 
     CILK_ASSERT(w, parent->frame != NULL);
     CILK_ASSERT(w, parent->frame->worker == (__cilkrts_worker *)0xbfbfbfbfbf);
-    CILK_ASSERT(w, parent->owner_ready_deque == NO_WORKER);
+    CILK_ASSERT(w, Closure_owner_deque(parent) == NO_WORKER);
     CILK_ASSERT(w, (parent->fiber == NULL) && parent->fiber_child);
     parent->fiber = parent->fiber_child;
     parent->fiber_child = NULL;
@@ -293,9 +469,10 @@ static Closure *provably_good_steal_maybe(__cilkrts_worker *const w,
 
         /* do a provably-good steal; this is *really* simple */
         w->l->provably_good_steal = true;
+        CILK_COUNT(w, COUNTER_PROVABLY_GOOD);
 
         setup_for_sync(w, parent);
-        CILK_ASSERT(w, parent->owner_ready_deque == NO_WORKER);
+        CILK_ASSERT(w, Closure_owner_deque(parent) == NO_WORKER);
         Closure_make_ready(parent);
 
         cilkrts_alert(STEAL | ALERT_SYNC, w,
@@ -345,7 +522,7 @@ Closure *Closure_return(__cilkrts_worker *const w, Closure *child) {
     CILK_ASSERT(w, child);
     CILK_ASSERT(w, child->join_counter == 0);
     CILK_ASSERT(w, child->status == CLOSURE_RETURNING);
-    CILK_ASSERT(w, child->owner_ready_deque == NO_WORKER);
+    CILK_ASSERT(w, Closure_owner_deque(child) == NO_WORKER);
     Closure_assert_alienation(w, child);
 
     CILK_ASSERT(w, child->has_cilk_callee == 0);
@@ -802,14 +979,14 @@ static Closure *promote_child(__cilkrts_worker *const w,
     Closure_assert_ownership(w, cl);
 
     CILK_ASSERT(w, cl->status == CLOSURE_RUNNING);
-    CILK_ASSERT(w, cl->owner_ready_deque == pn);
+    CILK_ASSERT(w, Closure_owner_deque(cl) == pn);
     CILK_ASSERT(w, cl->next_ready == NULL);
 
     /* cl may have a call parent: it might be promoted as its containing
      * stacklet is stolen, and it's call parent is promoted into full and
      * suspended
      */
-    CILK_ASSERT(w, cl == w->g->root_closure || cl->spawn_parent ||
+    CILK_ASSERT(w, cl->root || cl->spawn_parent ||
                        cl->call_parent);
 
     Closure *spawn_parent = NULL;
@@ -1009,25 +1186,33 @@ static Closure *Closure_steal(__cilkrts_worker *const w, int victim) {
 
     // Fast test for an unsuccessful steal attempt using only read operations.
     // This fast test seems to improve parallel performance.
-    {
-        __cilkrts_stack_frame **head =
-            atomic_load_explicit(&victim_w->head, memory_order_relaxed);
-        __cilkrts_stack_frame **tail =
-            atomic_load_explicit(&victim_w->tail, memory_order_relaxed);
-        if (head >= tail)
-            return NULL;
+    if (victim_work(w->g, victim) == 0) {
+        CILK_COUNT(w, COUNTER_STEAL_EMPTY);
+        return NULL;
     }
 
     //----- EVENT_STEAL_ATTEMPT
     if (deque_trylock(w, victim) == 0) {
+        CILK_COUNT(w, COUNTER_STEAL_LOCKED);
         return NULL;
     }
 
+    // Closures the victim stole in a batch and has not started are taken as
+    // they are, without promoting anything.
+    res = deque_stash_xtract_top(w, victim);
+    if (res) {
+        cilkrts_alert(STEAL, w, "(Closure_steal) stashed closure %p from W%d",
+                      (void *)res, victim);
+        deque_unlock(w, victim);
+        return res;
+    }
+
     cl = deque_peek_top(w, victim);
 
     if (cl) {
         if (Closure_trylock(w, cl) == 0) {
             deque_unlock(w, victim);
+            CILK_COUNT(w, COUNTER_STEAL_LOCKED);
             return NULL;
         }
 
@@ -1066,11 +1251,13 @@ static Closure *Closure_steal(__cilkrts_worker *const w, int victim) {
                 CILK_ASSERT(w, res->frame->worker == victim_w);
                 Closure_unlock(w, res);
             } else {
+                CILK_COUNT(w, COUNTER_STEAL_DEKKER);
                 goto give_up;
             }
             break;
 
         case CLOSURE_RETURNING: /* ok, let it leave alone */
+            CILK_COUNT(w, COUNTER_STEAL_RETURNING);
         give_up:
             // MUST unlock the closure before the queue;
             // see rule D in the file PROTOCOLS
@@ -1082,13 +1269,14 @@ static Closure *Closure_steal(__cilkrts_worker *const w, int victim) {
             // It's possible that this steal attempt peeked the root closure
             // from the top of a deque while a new Cilkified region was
             // starting.
-            if (cl != w->g->root_closure)
+            if (!cl->root)
                 cilkrts_bug(victim_w, "Bug: %s closure in ready deque",
                             Closure_status_to_str(cl->status));
         }
     } else {
         deque_unlock(w, victim);
         //----- EVENT_STEAL_EMPTY_DEQUE
+        CILK_COUNT(w, COUNTER_STEAL_EMPTY);
     }
 
     return res;
@@ -1185,9 +1373,8 @@ void longjmp_to_user_code(__cilkrts_worker *w, Closure *t) {
         // This is the first time we run the root closure in this Cilkified
         // region.  The closure has been completely setup at this point by
         // invoke_cilkified_root().  We just need jump to the user code.
-        volatile bool *initialized = &w->g->root_closure_initialized;
-        if (t == w->g->root_closure && *initialized == 0) {
-            *initialized = true;
+        if (t->root && !t->root->initialized) {
+            t->root->initialized = true;
         } else if (!t->simulated_stolen) {
             void *new_rsp = sysdep_reset_stack_for_resume(fiber, sf);
             USE_UNUSED(new_rsp);
@@ -1260,6 +1447,7 @@ int Cilk_sync(__cilkrts_worker *const w, __cilkrts_stack_frame *frame) {
         cilkrts_alert(SYNC, w,
                       "(Cilk_sync) Closure %p has outstanding children",
                       (void *)t);
+        CILK_COUNT(w, COUNTER_SYNC_FAILED);
 
         // if we are syncing from the personality function (i.e. if an
         // exception in the continuation was thrown), we still need this
@@ -1275,6 +1463,8 @@ int Cilk_sync(__cilkrts_worker *const w, __cilkrts_stack_frame *frame) {
         // reduce these when successful provably good steal occurs
         cilkred_map *reducers = w->reducer_map;
         w->reducer_map = NULL;
+        if (w->g->options.leapfrog)
+            leapfrog_record(w, t);
         Closure_suspend(w, t);
         t->user_rmap = reducers; /* set this after state change to suspended */
         res = SYNC_NOT_READY;
@@ -1337,9 +1527,7 @@ static Closure *do_what_it_says(__cilkrts_worker *w, Closure *t) {
 
         // MUST unlock the closure before locking the queue
         // (rule A in file PROTOCOLS)
-        deque_lock_self(w);
-        deque_add_bottom(w, t, w->self);
-        deque_unlock_self(w);
+        deque_add_bottom_self(w, t);
 
         /* now execute it */
         cilkrts_alert(SCHED, w, "(do_what_it_says) Jump into user code");
@@ -1386,10 +1574,29 @@ static Closure *do_what_it_says(__cilkrts_worker *w, Closure *t) {
     return res;
 }
 
+// After a successful steal from victim, keep stealing from it, up to
+// options.steal_batch closures in all.  Spawn trees that are wide at the top
+// leave several stealable frames on one victim, and taking them together
+// saves the thieves a search for each.  The extra closures wait in w's stash,
+// from which w runs them when it is next out of work and other thieves may
+// take them.
+static void steal_batch(__cilkrts_worker *w, unsigned int victim) {
+    for (unsigned int i = 1; i < w->g->options.steal_batch; ++i) {
+        Closure *extra = Closure_steal(w, victim);
+        CILK_COUNT(w, COUNTER_STEAL_ATTEMPT);
+        if (!extra)
+            break;
+        CILK_COUNT(w, COUNTER_STEAL);
+        CILK_COUNT(w, COUNTER_STEAL_BATCHED);
+        deque_stash_push(w, extra);
+    }
+}
+
 void worker_scheduler(__cilkrts_worker *w, Closure *t) {
 
     CILK_ASSERT(w, w == __cilkrts_get_tls_worker());
     rts_srand(w, w->self * 162347);
+    w->l->nleapfrog = 0;
 
     CILK_START_TIMING(w, INTERVAL_SCHED);
     worker_change_state(w, WORKER_SCHED);
@@ -1399,9 +1606,7 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
     while (!atomic_load_explicit(&w->g->done, memory_order_acquire)) {
         if (!t) {
             // try to get work from our local queue
-            deque_lock_self(w);
-            t = deque_xtract_bottom(w, w->self);
-            deque_unlock_self(w);
+            t = deque_xtract_bottom_self(w);
             /* A worker entering the steal loop must have saved its
                reducer map into the frame to which it belongs. */
             if (!t) {
@@ -1411,11 +1616,46 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
         CILK_STOP_TIMING(w, INTERVAL_SCHED);
 
         while (!t && !atomic_load_explicit(&w->g->done, memory_order_acquire)) {
+            if (worker_is_lent(w)) {
+                // Another runtime is using this worker's CPU.
+                worker_set_hungry(w, false);
+                worker_park_lent(w);
+                fails = 0;
+                continue;
+            }
+            // Run a closure left over from a batched steal.
+            t = deque_stash_xtract_bottom_self(w);
+            if (t) {
+                fails = 0;
+                break;
+            }
+            // Start a Cilkified region submitted to a multi-root runtime.
+            t = root_take(w);
+            if (t) {
+                fails = 0;
+                break;
+            }
+            // Run chunks of a statically partitioned loop.
+            if (loop_help(w)) {
+                fails = 0;
+                continue;
+            }
+            if (w->serial) {
+                // A lone worker has no victims.  Sleep until a root is
+                // submitted or the runtime shuts down.
+                worker_park(w);
+                continue;
+            }
+            worker_set_hungry(w, true);
             CILK_START_TIMING(w, INTERVAL_SCHED);
             CILK_START_TIMING(w, INTERVAL_IDLE);
-            unsigned int victim = rts_rand(w) % w->g->nworkers;
+            unsigned int victim = choose_victim(w);
             if (victim != w->self) {
                 t = Closure_steal(w, victim);
+                CILK_COUNT(w, COUNTER_STEAL_ATTEMPT);
+                if (t)
+                    CILK_COUNT(w, COUNTER_STEAL);
+                victim_steal_result(w, victim, t != NULL);
             }
 #if SCHED_STATS
             if (t) { // steal successful
@@ -1428,16 +1668,19 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
 #endif
             if (t) {
                 fails = 0;
+                if (w->g->options.steal_batch > 1)
+                    steal_batch(w, victim);
+                // The victim may have more work to steal.  Let a parked
+                // worker look for it.
+                worker_wake_one(w);
                 break;
             }
-            /* TODO: Use condition variables or a similar controlled
-               blocking mechanism.  When a thread finds something to steal
-               it should wake up another thread to enter the loop. */
             ++fails;
-            if (fails > 100000) {
-                usleep(10);
-            } else if (fails > 10000) {
-                usleep(1);
+            if (fails > 10000) {
+                // Sleep until a worker makes stealable work available or the
+                // Cilkified region finishes.
+                worker_park(w);
+                fails = 0;
             } else if (fails > 1000) {
 #if defined __APPLE__ || defined __linux__
                 sched_yield();
@@ -1453,6 +1696,7 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
 #endif
             }
         }
+        worker_set_hungry(w, false);
         CILK_START_TIMING(w, INTERVAL_SCHED);
         // If one Cilkified region stops and another one starts, then a worker
         // can reach this point with t == NULL and w->g->done == false.  Check
@@ -1461,6 +1705,12 @@ void worker_scheduler(__cilkrts_worker *w, Closure *t) {
             // if provably-good steal happens, do_what_it_says will return
             // the next closure to execute
             t = do_what_it_says(w, t);
+            // w has left the fiber of any root it just finished, so the
+            // root's thread may now reuse it.
+            if (w->l->finished_root) {
+                root_complete(w->l->finished_root);
+                w->l->finished_root = NULL;
+            }
         }
     }
     CILK_STOP_TIMING(w, INTERVAL_SCHED);
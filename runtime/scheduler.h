@@ -3,6 +3,7 @@
 
 #include "cilk-internal.h"
 #include "closure.h"
+#include "internal-malloc.h"
 
 #define SYNC_READY 0
 #define SYNC_NOT_READY 1
@@ -26,4 +27,20 @@ CHEETAH_INTERNAL void worker_scheduler(__cilkrts_worker *ws, Closure *t);
 
 CHEETAH_INTERNAL void promote_own_deque(__cilkrts_worker *w);
 
+// Shadow stacks occupy whole pages of their own so that they can be moved
+// to their owner's NUMA node.  This is the allocation size for a shadow
+// stack with the given number of entries.
+static inline size_t shadow_stack_bytes(size_t entries) {
+    size_t page_size = (size_t)1 << cheetah_page_shift;
+    size_t size = entries * sizeof(__cilkrts_stack_frame *);
+    return (size + page_size - 1) & ~(page_size - 1);
+}
+
+// Allocate a zeroed shadow stack with the given number of entries.
+CHEETAH_INTERNAL __cilkrts_stack_frame **shadow_stack_alloc(size_t entries);
+
+// Called from __cilkrts_detach when w's shadow stack is full.  Doubles it and
+// returns the new tail.  Must be visible to compiled code.
+__cilkrts_stack_frame **__cilkrts_grow_shadow_stack(__cilkrts_worker *w);
+
 #endif
@@ -0,0 +1,238 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <unistd.h>
+
+#include "cilk-internal.h"
+#include "debug.h"
+#include "global.h"
+#include "internal-malloc.h"
+#include "local.h"
+#include "topology.h"
+
+// Without topology information, workers with nearby IDs share a counter of
+// idle thieves.
+static void default_idle_groups(global_state *g) {
+    for (unsigned int i = 0; i < g->nworkers; ++i)
+        g->workers[i]->l->idle_group =
+            (unsigned long)i * CILK_IDLE_GROUPS / g->nworkers;
+}
+
+#if defined __linux__ && defined CPU_SETSIZE
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+#define SYSFS_NODE "/sys/devices/system/node"
+
+// What we need to know about the CPU a worker is bound to.
+struct cpu_place {
+    cpu_set_t core;  // hyperthreads of this core
+    cpu_set_t cache; // CPUs sharing the last-level cache
+    int socket;      // NUMA node, or package if there is no node map
+};
+
+// Parse a sysfs CPU list such as "0-3,8,10-11" into set.  Returns false if
+// the file could not be read.
+static bool read_cpulist(const char *path, cpu_set_t *set) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    CPU_ZERO(set);
+    int lo, hi;
+    bool ok = false;
+    while (fscanf(f, "%d", &lo) == 1) {
+        hi = lo;
+        int c = fgetc(f);
+        if (c == '-') {
+            if (fscanf(f, "%d", &hi) != 1)
+                break;
+            c = fgetc(f);
+        }
+        for (int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; ++cpu)
+            CPU_SET(cpu, set);
+        ok = true;
+        if (c != ',')
+            break;
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool read_int(const char *path, int *value) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    bool ok = fscanf(f, "%d", value) == 1;
+    fclose(f);
+    return ok;
+}
+
+// Find the NUMA node of cpu, or -1 if there is no node map.  Node IDs may
+// be sparse, so look only at the nodes listed as online.
+static int cpu_node(int cpu) {
+    char path[128];
+    cpu_set_t nodes;
+    if (!read_cpulist(SYSFS_NODE "/online", &nodes))
+        return -1;
+    for (int node = 0; node < CPU_SETSIZE; ++node) {
+        if (!CPU_ISSET(node, &nodes))
+            continue;
+        cpu_set_t cpus;
+        snprintf(path, sizeof path, SYSFS_NODE "/node%d/cpulist", node);
+        if (read_cpulist(path, &cpus) && CPU_ISSET(cpu, &cpus))
+            return node;
+    }
+    return -1;
+}
+
+static bool read_cpu_place(int cpu, struct cpu_place *p) {
+    char path[128];
+
+    snprintf(path, sizeof path, SYSFS_CPU "/cpu%d/topology/thread_siblings_list",
+             cpu);
+    if (!read_cpulist(path, &p->core))
+        return false;
+
+    // The last-level cache is the one with the highest level.
+    int best = 0;
+    CPU_ZERO(&p->cache);
+    for (int index = 0;; ++index) {
+        int level;
+        snprintf(path, sizeof path, SYSFS_CPU "/cpu%d/cache/index%d/level",
+                 cpu, index);
+        if (!read_int(path, &level))
+            break;
+        if (level < best)
+            continue;
+        snprintf(path, sizeof path,
+                 SYSFS_CPU "/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+        if (read_cpulist(path, &p->cache))
+            best = level;
+    }
+    if (best == 0)
+        p->cache = p->core;
+
+    p->socket = cpu_node(cpu);
+    if (p->socket < 0) {
+        snprintf(path, sizeof path,
+                 SYSFS_CPU "/cpu%d/topology/physical_package_id", cpu);
+        if (!read_int(path, &p->socket))
+            return false;
+    }
+    return true;
+}
+
+static enum victim_level distance(const struct cpu_place *from,
+                                  const struct cpu_place *to, int to_cpu) {
+    if (CPU_ISSET(to_cpu, &from->core))
+        return VICTIM_CORE;
+    if (CPU_ISSET(to_cpu, &from->cache))
+        return VICTIM_CACHE;
+    if (from->socket == to->socket)
+        return VICTIM_SOCKET;
+    return VICTIM_REMOTE;
+}
+
+void topology_init(global_state *g, const int *cpus) {
+    unsigned int nworkers = g->nworkers;
+
+    topology_deinit(g);
+    default_idle_groups(g);
+    if (nworkers < 2)
+        return;
+
+    struct cpu_place *places =
+        (struct cpu_place *)calloc(nworkers, sizeof(struct cpu_place));
+    for (unsigned int i = 0; i < nworkers; ++i) {
+        if (cpus[i] < 0 || !read_cpu_place(cpus[i], &places[i])) {
+            cilkrts_alert(BOOT, NULL,
+                          "(topology_init) No topology for worker %u; "
+                          "stealing uniformly",
+                          i);
+            free(places);
+            return;
+        }
+    }
+
+    enum victim_level *level = (enum victim_level *)calloc(
+        nworkers, sizeof(enum victim_level));
+    for (unsigned int i = 0; i < nworkers; ++i) {
+        struct victim_list *vl = &g->workers[i]->l->victims;
+        vl->victims = (worker_id *)calloc(nworkers - 1, sizeof(worker_id));
+        g->workers[i]->l->idle_group = places[i].socket % CILK_IDLE_GROUPS;
+
+        for (unsigned int j = 0; j < nworkers; ++j)
+            level[j] = distance(&places[i], &places[j], cpus[j]);
+
+        // Counting sort of the other workers by distance from worker i.
+        unsigned int n = 0;
+        for (int l = 0; l < NUMBER_OF_VICTIM_LEVELS; ++l) {
+            for (unsigned int j = 0; j < nworkers; ++j) {
+                if (j != i && level[j] == (enum victim_level)l)
+                    vl->victims[n++] = j;
+            }
+            vl->end[l] = n;
+        }
+        CILK_ASSERT_G(n == nworkers - 1);
+
+        cilkrts_alert(BOOT, NULL,
+                      "(topology_init) Worker %u on CPU %d: %u core, %u "
+                      "cache, %u socket, %u remote victims",
+                      i, cpus[i], vl->end[VICTIM_CORE],
+                      vl->end[VICTIM_CACHE] - vl->end[VICTIM_CORE],
+                      vl->end[VICTIM_SOCKET] - vl->end[VICTIM_CACHE],
+                      vl->end[VICTIM_REMOTE] - vl->end[VICTIM_SOCKET]);
+    }
+    free(level);
+    free(places);
+}
+
+#else
+
+void topology_init(global_state *g, const int *cpus) { default_idle_groups(g); }
+
+#endif
+
+#if defined __linux__ && defined SYS_move_pages && defined SYS_getcpu
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1) /* from <numaif.h> */
+#endif
+
+void topology_move_home(void *addr, size_t size) {
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+        return;
+    // Shadow stacks can be large and this may run on a fiber stack, so move
+    // the pages in batches.
+    enum { BATCH = 64 };
+    void *pages[BATCH];
+    int nodes[BATCH], status[BATCH];
+    size_t npages = size >> cheetah_page_shift;
+    for (size_t done = 0; done < npages; done += BATCH) {
+        size_t n = npages - done < BATCH ? npages - done : BATCH;
+        for (size_t i = 0; i < n; ++i) {
+            pages[i] = (char *)addr + ((done + i) << cheetah_page_shift);
+            nodes[i] = (int)node;
+        }
+        if (syscall(SYS_move_pages, 0, n, pages, nodes, status,
+                    MPOL_MF_MOVE) != 0)
+            return;
+    }
+}
+#else
+void topology_move_home(void *addr, size_t size) {}
+#endif
+
+void topology_deinit(global_state *g) {
+    for (unsigned int i = 0; i < g->nworkers; ++i) {
+        struct victim_list *vl = &g->workers[i]->l->victims;
+        free(vl->victims);
+        vl->victims = NULL;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef _CILK_TOPOLOGY_H
+#define _CILK_TOPOLOGY_H
+
+#include "cilk-internal.h"
+#include "rts-config.h"
+
+// How far apart two workers are, from nearest to farthest.
+enum victim_level {
+    VICTIM_CORE = 0,        // hyperthreads of the same core
+    VICTIM_CACHE,           // cores sharing the last-level cache
+    VICTIM_SOCKET,          // the same NUMA node, or package without a node map
+    VICTIM_REMOTE,          // everything else
+    NUMBER_OF_VICTIM_LEVELS // must be the very last entry
+};
+
+// The potential victims of one worker, sorted from nearest to farthest.
+// The victims at level l or nearer are victims[0 .. end[l]).
+struct victim_list {
+    worker_id *victims;
+    unsigned int end[NUMBER_OF_VICTIM_LEVELS];
+};
+
+// Build the victim list of every worker in g.  cpus[i] is the first CPU
+// worker i is bound to, or -1 if it is not bound.  If any worker is unbound
+// or the topology cannot be read, the victim lists are left empty and
+// workers choose victims uniformly at random.  Also assigns each worker the
+// counter of idle thieves of its socket.
+CHEETAH_INTERNAL void topology_init(global_state *g, const int *cpus);
+CHEETAH_INTERNAL void topology_deinit(global_state *g);
+
+// Move the pages of [addr, addr + size), which must be whole pages that no
+// other data shares, to the NUMA node of the CPU the calling thread runs
+// on.  Does nothing on kernels without NUMA support.
+CHEETAH_INTERNAL void topology_move_home(void *addr, size_t size);
+
+#endif /* _CILK_TOPOLOGY_H */